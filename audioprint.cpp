@@ -0,0 +1,70 @@
+#include <cmath>
+#include <algorithm>
+#include <opencv2/core/core.hpp>
+#include "audioprint.h"
+
+constexpr int AudioPrint::_sampleRate;
+constexpr int AudioPrint::_seconds;
+constexpr int AudioPrint::_minShared;
+constexpr int AudioPrint::_sharedPercent;
+constexpr int AudioPrint::_commonValue;
+
+QVector<uint32_t> AudioPrint::compute(const QByteArray &pcm)
+{
+    QVector<uint32_t> prints;
+    const auto *samples = reinterpret_cast<const int16_t *>(pcm.constData());
+    const int sampleCount = pcm.size() / static_cast<int>(sizeof(int16_t));
+    if(sampleCount < _frameSize)
+        return prints;
+
+    int bandEdge[_bands + 1];                           //logarithmically spaced, as hearing is
+    for(int band=0; band<=_bands; band++)
+    {
+        const double hz = _lowestHz * pow(static_cast<double>(_highestHz) / _lowestHz, static_cast<double>(band) / _bands);
+        bandEdge[band] = static_cast<int>(hz * _frameSize / _sampleRate);
+    }
+    cv::Mat window(1, _frameSize, CV_32F);              //Hann window
+    for(int i=0; i<_frameSize; i++)
+        window.at<float>(i) = static_cast<float>(0.5 - 0.5 * cos(2 * CV_PI * i / (_frameSize - 1)));
+
+    double energy[_bands], previous[_bands];
+    bool previousValid = false;
+    cv::Mat frame(1, _frameSize, CV_32F), spectrum;
+    for(int start=0; start+_frameSize<=sampleCount; start+=_frameStep)
+    {
+        int64_t amplitude = 0;
+        for(int i=0; i<_frameSize; i++)
+        {
+            amplitude += qAbs(static_cast<int>(samples[start + i]));
+            frame.at<float>(i) = samples[start + i] * window.at<float>(i);
+        }
+        if(amplitude < static_cast<int64_t>(_silence) * _frameSize)
+        {
+            previousValid = false;                      //silence is same in every video
+            continue;
+        }
+
+        cv::dft(frame, spectrum, cv::DFT_COMPLEX_OUTPUT);
+        for(int band=0; band<_bands; band++)
+        {
+            energy[band] = 0;
+            for(int bin=bandEdge[band]; bin<bandEdge[band+1]; bin++)
+            {
+                const cv::Vec2f &value = spectrum.at<cv::Vec2f>(bin);
+                energy[band] += value[0] * value[0] + value[1] * value[1];
+            }
+        }
+
+        if(previousValid)
+        {
+            uint32_t print = 0;
+            for(int bit=0; bit<_bands-1; bit++)
+                if(energy[bit] - energy[bit+1] - (previous[bit] - previous[bit+1]) > 0)
+                    print |= 1u << bit;
+            prints << print;
+        }
+        std::copy(energy, energy + _bands, previous);
+        previousValid = true;
+    }
+    return prints;
+}
@@ -0,0 +1,33 @@
+#ifndef AUDIOPRINT_H
+#define AUDIOPRINT_H
+
+#include <QByteArray>
+#include <QVector>
+
+//audio fingerprint after Haitsma and Kalker: every frame gives a 32 bit sub-fingerprint from the signs of energy
+//differences between neighbouring frequency bands and consecutive frames. re-encoded audio keeps many of them bit
+//exact, so videos sharing sound are found through an inverted index of sub-fingerprints instead of comparing pairs
+
+class AudioPrint
+{
+
+public:
+    static constexpr int _sampleRate    = 5512;         //mono, enough for bands up to 2000 Hz
+    static constexpr int _seconds       = 2;            //decoded at each capture point
+    static constexpr int _minShared     = 5;            //pairs match if they share this many sub-fingerprints...
+    static constexpr int _sharedPercent = 2;            //...and this much of the shorter fingerprint
+    static constexpr int _commonValue   = 64;           //sub-fingerprints of more videos than this say nothing
+
+    //sub-fingerprints of signed 16 bit mono samples, silent frames are left out
+    static QVector<uint32_t> compute(const QByteArray &pcm);
+
+private:
+    static constexpr int _frameSize     = 2048;         //0.37s frames
+    static constexpr int _frameStep     = 64;           //small step so that captures seeked differently still align
+    static constexpr int _bands         = 33;           //33 bands give 32 bits
+    static constexpr int _lowestHz      = 300;
+    static constexpr int _highestHz     = 2000;
+    static constexpr int _silence       = 30;           //mean absolute amplitude of a silent frame
+};
+
+#endif // AUDIOPRINT_H
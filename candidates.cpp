@@ -0,0 +1,210 @@
+#include "candidates.h"
+#include "session.h"
+#include "audioprint.h"
+
+constexpr int Candidates::_maxDurationModifier;
+constexpr int Candidates::_ssimGate;
+constexpr int Candidates::_minFrames;
+
+void Candidates::build(const Session &session, const Prefs &prefs)
+{
+    clear();
+
+    _windowPercent = prefs._durationWindowPercent;
+    _windowSeconds = prefs._durationWindowSeconds;
+    _widenWindow = session.thumbnailMode() == cutEnds;     //videos with cut ends differ more in duration
+    const int lowest = lowestSimilarity(prefs._thresholdPhash);
+    if(_cancelled)
+        return;
+    switch(session.hashAlgorithm())
+    {
+        case Prefs::_DIFFERENCE: compare<DifferenceHash>(session, lowest); break;
+        case Prefs::_AVERAGE:    compare<AverageHash>(session, lowest); break;
+        case Prefs::_WAVELET:    compare<WaveletHash>(session, lowest); break;
+        case Prefs::_DCT256:     compare<WidePerceptualHash>(session, lowest); break;
+        default:                 compare<PerceptualHash>(session, lowest);
+    }
+    if(_cancelled)
+    {
+        clear();
+        return;
+    }
+    std::sort(_pairs.begin(), _pairs.end(), [](const Candidate &a, const Candidate &b)
+                                            { return a.bestDistance() < b.bestDistance(); });
+    _pairs.squeeze();
+    _lowestSimilarity = lowest;
+    _built = true;
+}
+
+bool Candidates::covers(const Prefs &prefs) const
+{
+    return _built && lowestSimilarity(prefs._thresholdPhash) >= _lowestSimilarity &&
+           prefs._durationWindowPercent == _windowPercent && prefs._durationWindowSeconds == _windowSeconds;
+}
+
+bool Candidates::withinWindow(const int64_t &duration, const int64_t &otherDuration,
+                              const int &percent, const int &seconds, const bool &widen)
+{
+    if(!percent && !seconds)
+        return true;
+    int64_t window = seconds? seconds * 1000 : qMax(duration, otherDuration) * percent / 100;
+    if(widen)
+        window *= 2;
+    window = qMax(window, static_cast<int64_t>(1000));     //same duration pairs are always compared
+    return qAbs(duration - otherDuration) <= window;
+}
+
+template<class Hasher> Candidate Candidates::pair(const Session &session, const int &left, const int &right) const
+{
+    Candidate candidate;
+    candidate.left = left;
+    candidate.right = right;
+    candidate.sameDuration = qAbs(session.duration(left) - session.duration(right)) <= 1000;
+
+    const int hashes = session.thumbnailMode() == cutEnds? 2 : 1;
+    for(int hash=0; hash<hashes; hash++)
+    {
+        const Fingerprint &leftHash = session.hash(left, hash);
+        const Fingerprint &rightHash = session.hash(right, hash);
+        if(!leftHash.isNull() || !rightHash.isNull())
+            candidate.distance[hash] = static_cast<uint8_t>(64 - similarityOf64<Hasher>(leftHash, rightHash));
+    }
+    return candidate;
+}
+
+template<class Hasher> int Candidates::frameDistance(const Session &session, const int &left, const int &right,
+                                                     const int &maxDistance) const
+{                                               //worst screen capture decides, first one too different ends it
+    int worst = 0;
+    int frames = 0;
+    for(int frame=0; frame<session.frameCount(); frame++)
+    {
+        const Fingerprint &leftHash = session.frameHash(left, frame);
+        const Fingerprint &rightHash = session.frameHash(right, frame);
+        if(leftHash.isNull() || rightHash.isNull())
+            continue;                           //(almost) monochrome capture tells nothing
+        const int distance = 64 - similarityOf64<Hasher>(leftHash, rightHash);
+        if(distance > maxDistance)
+            return 255;
+        worst = qMax(worst, distance);
+        frames++;
+    }
+    return frames >= _minFrames? worst : 255;
+}
+
+template<class Hasher> void Candidates::compare(const Session &session, const int &lowest)
+{
+    QVector<int> byDuration(session.count());      //pairs of sorted videos are compared until durations differ too much
+    for(int video=0; video<byDuration.count(); video++)
+        byDuration[video] = video;
+    std::sort(byDuration.begin(), byDuration.end(), [&session](const int &a, const int &b)
+                                                    { return session.duration(a) < session.duration(b); });
+
+    auto compareSorted = [&](const int &first, const int &second)
+    {
+        _comparedPairs++;
+        Candidate candidate = pair<Hasher>(session, qMin(byDuration[first], byDuration[second]),
+                                                    qMax(byDuration[first], byDuration[second]));
+        if(64 - candidate.bestDistance() < lowest && session.thumbnailMode() != cutEnds)
+            candidate.distance[0] = static_cast<uint8_t>(frameDistance<Hasher>(session, candidate.left,
+                                                                              candidate.right, 64 - lowest));
+        if(64 - candidate.bestDistance() >= lowest)
+            _pairs << candidate;
+    };
+
+    if(session.queryCount())                        //query mode: library videos are never paired with each other
+    {
+        for(int query=0; query<byDuration.count() && !_cancelled; query++)
+        {
+            if(!session.query(byDuration[query]))
+                continue;
+            for(int longer=query+1; longer<byDuration.count(); longer++)
+            {
+                if(!withinWindow(session.duration(byDuration[query]), session.duration(byDuration[longer])))
+                    break;
+                compareSorted(query, longer);
+            }
+            for(int shorter=query-1; shorter>=0; shorter--)
+            {
+                if(!withinWindow(session.duration(byDuration[shorter]), session.duration(byDuration[query])))
+                    break;
+                if(!session.query(byDuration[shorter]))     //two queries were paired by the shorter one
+                    compareSorted(shorter, query);
+            }
+        }
+        compareAudio<Hasher>(session);
+        return;
+    }
+
+    for(int shorter=0; shorter<byDuration.count() && !_cancelled; shorter++)
+        for(int longer=shorter+1; longer<byDuration.count(); longer++)
+        {
+            if(!withinWindow(session.duration(byDuration[shorter]), session.duration(byDuration[longer])))
+                break;                              //longer ones that follow differ even more
+            compareSorted(shorter, longer);
+        }
+
+    compareAudio<Hasher>(session);
+}
+
+template<class Hasher> void Candidates::compareAudio(const Session &session)
+{
+    QVector< QVector<uint32_t> > prints(session.count());      //each sub-fingerprint once per video
+    QHash< uint32_t, QVector<int> > index;                      //videos having each sub-fingerprint
+    for(int video=0; video<session.count(); video++)
+    {
+        const uint32_t *audioPrints = session.audioPrints(video);
+        QVector<uint32_t> &distinct = prints[video];
+        distinct.reserve(session.audioPrintCount(video));
+        for(int print=0; print<session.audioPrintCount(video); print++)
+            distinct << audioPrints[print];
+        std::sort(distinct.begin(), distinct.end());
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        for(const auto &print : distinct)
+            index[print] << video;
+    }
+    if(index.isEmpty())
+        return;
+
+    for(int left=0; left<session.count() && !_cancelled; left++)
+    {
+        QHash<int, int> shared;                                 //sub-fingerprints shared with each later video
+        for(const auto &print : prints[left])
+        {
+            const QVector<int> &videos = *index.constFind(print);
+            if(videos.count() > AudioPrint::_commonValue)
+                continue;
+            for(const auto &video : videos)
+                if(video > left)
+                    shared[video]++;
+        }
+        for(auto right=shared.cbegin(); right!=shared.cend(); right++)
+        {
+            const int shorter = qMin(prints[left].count(), prints[right.key()].count());
+            if((session.queryCount() && !session.query(left) && !session.query(right.key())) ||
+               right.value() < qMax(AudioPrint::_minShared, shorter * AudioPrint::_sharedPercent / 100) ||
+               !withinWindow(session.duration(left), session.duration(right.key())))
+                continue;
+            _audioPairs << pair<Hasher>(session, left, right.key());
+        }
+    }
+}
+
+void Candidates::useSsimBlockSize(const int &blockSize)
+{
+    if(blockSize == _ssimBlockSize)
+        return;
+    for(auto &pair : _pairs)
+        pair.ssim[0] = pair.ssim[1] = -1;
+    _ssimBlockSize = blockSize;
+}
+
+void Candidates::clear()
+{
+    _pairs = QVector<Candidate>();
+    _audioPairs = QVector<Candidate>();
+    _built = false;
+    _lowestSimilarity = 64;
+    _comparedPairs = 0;
+    _ssimBlockSize = 0;
+}
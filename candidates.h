@@ -0,0 +1,90 @@
+#ifndef CANDIDATES_H
+#define CANDIDATES_H
+
+#include <QVector>
+#include <atomic>
+#include "hasher.h"
+#include "prefs.h"
+
+class Session;
+
+struct Candidate
+{
+    int left = 0;                               //indexes of videos in session
+    int right = 0;
+    uint8_t distance[2] = { 255, 255 };         //differing bits of 64 for each hash, 255 if neither has fingerprint
+    bool sameDuration = false;                  //durations within 1s
+    float ssim[2] = { -1, -1 };                 //negative until computed
+
+    int bestDistance() const { return qMin(distance[0], distance[1]); }
+};
+
+//every pair of a session that can match is compared only once. threshold and duration modifiers are applied on the
+//stored distances afterwards, so changing them does not need the fingerprints again. a pair whose thumbnails differ
+//too much still matches if each screen capture alone is close enough, for videos where a few captures spoil the
+//thumbnail as a whole
+
+class Candidates
+{
+
+public:
+    static constexpr int _maxDurationModifier = 5;     //largest modifier selectable in main window
+    static constexpr int _ssimGate = 44;               //SSIM is slow, only computed if pHash differs at most 20 bits
+    static constexpr int _minFrames = 2;               //frame by frame rule needs this many frames with picture
+
+private:
+    QVector<Candidate> _pairs;
+    QVector<Candidate> _audioPairs;
+    bool _built = false;
+    int _lowestSimilarity = 64;                 //pairs with fewer same bits of 64 were left out
+    int _windowPercent = 0;                     //pairs differing more in duration were not compared
+    int _windowSeconds = 0;
+    bool _widenWindow = false;
+    int64_t _comparedPairs = 0;
+    int _ssimBlockSize = 0;                     //SSIM scores stored were computed with this block size
+    std::atomic<bool> _cancelled { false };     //set from GUI thread while built in background
+
+    static int lowestSimilarity(const int &thresholdPhash) { return qMin(thresholdPhash, _ssimGate) - _maxDurationModifier; }
+    bool withinWindow(const int64_t &duration, const int64_t &otherDuration) const
+        { return withinWindow(duration, otherDuration, _windowPercent, _windowSeconds, _widenWindow); }
+    template<class Hasher> Candidate pair(const Session &session, const int &left, const int &right) const;
+    //worst distance of single screen captures, for pairs whose thumbnails differ too much. stops at first capture
+    //differing more than maxDistance, so it only adds matches and never rejects a pair the thumbnails matched
+    template<class Hasher> int frameDistance(const Session &session, const int &left, const int &right,
+                                             const int &maxDistance) const;
+    template<class Hasher> void compare(const Session &session, const int &lowest);
+    template<class Hasher> void compareAudio(const Session &session);
+
+public:
+    //compare fingerprints of pairs close enough in duration, keeping those that can match at this threshold with any
+    //duration modifier
+    void build(const Session &session, const Prefs &prefs);
+
+    //stop build running in another thread. pairs are cleared, so covers() is false afterwards. builds do nothing
+    //until set false again, which is done before starting one, so a cancel made before it starts is not lost
+    void cancelBuild(const bool &cancel) { _cancelled = cancel; }
+    bool buildCancelled() const { return _cancelled; }
+
+    //false if never built, or if built with a stricter threshold or another duration window
+    bool covers(const Prefs &prefs) const;
+
+    //durations are close enough to compare, widened for cut ends mode. no window if percent and seconds are 0
+    static bool withinWindow(const int64_t &duration, const int64_t &otherDuration,
+                             const int &percent, const int &seconds, const bool &widen);
+
+    //pairs whose fingerprints were compared, the rest differed too much in duration
+    int64_t comparedPairs() const { return _comparedPairs; }
+
+    //forget SSIM scores computed with different block size
+    void useSsimBlockSize(const int &blockSize);
+
+    void clear();
+
+    //sorted by best distance, most similar pairs first
+    QVector<Candidate> &pairs() { return _pairs; }
+
+    //pairs sharing enough audio sub-fingerprints, they match whatever their pictures look like
+    const QVector<Candidate> &audioPairs() const { return _audioPairs; }
+};
+
+#endif // CANDIDATES_H
@@ -1,13 +1,23 @@
 #include <QMessageBox>
 #include <QWheelEvent>
+#include <QtConcurrent/QtConcurrent>
 #include "comparison.h"
+#include "groupview.h"
 #include "ui_comparison.h"
 
-Comparison::Comparison(const QVector<Video *> &videosParam, const Prefs &prefsParam) :
-    QDialog(prefsParam._mainwPtr, Qt::Window), _videos(videosParam), _prefs(prefsParam)
+Comparison::Comparison(Session &sessionParam, const Prefs &prefsParam, const QVector<Match> &importedParam) :
+    QDialog(prefsParam._mainwPtr, Qt::Window), _session(sessionParam), _prefs(prefsParam),
+    _matches(importedParam), _matchesImported(!importedParam.isEmpty())
 {
     ui = new Ui::Comparison;
     ui->setupUi(this);
+    _left = { ui->leftImage, ui->leftFileName, ui->leftPathName, ui->leftFileSize, ui->leftDuration, ui->leftModified,
+              ui->leftResolution, ui->leftFrameRate, ui->leftBitRate, ui->leftCodec, ui->leftAudio };
+    _right = { ui->rightImage, ui->rightFileName, ui->rightPathName, ui->rightFileSize, ui->rightDuration, ui->rightModified,
+               ui->rightResolution, ui->rightFrameRate, ui->rightBitRate, ui->rightCodec, ui->rightAudio };
+    _thumbnailCache.setMaxCost(_thumbnailCacheSize);
+    _zoomCache.setMaxCost(_zoomCacheFrames);
+    _zoomPool.setMaxThreadCount(_zoomCaptureThreads);
 
     connect(this, SIGNAL(sendStatusMessage(const QString &)), _prefs._mainwPtr, SLOT(addStatusMessage(const QString &)));
     connect(this, SIGNAL(switchComparisonMode(const int &)),  _prefs._mainwPtr, SLOT(setComparisonMode(const int &)));
@@ -15,35 +25,221 @@ Comparison::Comparison(const QVector<Video *> &videosParam, const Prefs &prefsPa
 
     if(_prefs._comparisonMode == _prefs._SSIM)
         ui->selectSSIM->setChecked(true);
+    if(_matchesImported)
+        std::sort(_matches.begin(), _matches.end());
+    else if(_prefs._exportFile.isEmpty())
+        filterCandidates();
+    else                                            //every matching pair is saved to file as it is found
+    {
+        MatchFile exportFile(_prefs._exportFile);
+        if(exportFile.openForWriting())
+            filterCandidates(&exportFile);
+        else
+        {
+            emit sendStatusMessage(QStringLiteral("Error: could not write %1")
+                                   .arg(QDir::toNativeSeparators(_prefs._exportFile)));
+            filterCandidates();
+        }
+    }
     ui->thresholdSlider->setValue(QVariant(_prefs._thresholdSSIM * 100).toInt());
-    ui->progressBar->setMaximum(_prefs._numberOfVideos * (_prefs._numberOfVideos - 1) / 2);
+    ui->progressBar->setMaximum(_matches.count());
+    ui->showGroups->setDisabled(true);
 
     on_nextVideo_clicked();
 }
 
 Comparison::~Comparison()
 {
+    _zoomPool.clear();                              //captures not started yet are not needed anymore,
+    _zoomCancelled = true;                          //running ones are killed before pool is destroyed
+    _zoomPool.waitForDone();
+    _thumbnailPrefetch.waitForFinished();           //reads thumbnails from session
     delete ui;
 }
 
 void Comparison::reportMatchingVideos()
 {
-    int64_t combinedFilesize = 0;
-    int foundMatches = 0;
-
-    QVector<Video*>::const_iterator left, right, end = _videos.cend();
-    for(left=_videos.cbegin(); left<end; left++)
-        for(right=left+1; right<end; right++)
-            if(bothVideosMatch(*left, *right))
-            {   //smaller of two matching videos is likely the one to be deleted
-                combinedFilesize += std::min((*left)->size , (*right)->size);
-                foundMatches++;
-                break;
+    groupMatches();
+    reportGroups();
+    enableGroups();
+}
+
+void Comparison::filterCandidates(MatchFile *exportFile)
+{
+    Candidates &candidates = _session.candidates();
+    if(_building)                                   //slider moved while comparing, filtered when that is done
+        return;
+    while(!candidates.covers(_prefs))               //threshold went below what pairs were compared with
+    {
+        _building = true;
+        const Prefs prefs = _prefs;                 //slider may change _prefs meanwhile
+        candidates.cancelBuild(false);              //closing window from here on stops comparing
+        QFutureWatcher<void> building;
+        QEventLoop waitUntilBuilt;
+        connect(&building, &QFutureWatcher<void>::finished, &waitUntilBuilt, &QEventLoop::quit);
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        building.setFuture(QtConcurrent::run([this, &candidates, prefs]() { candidates.build(_session, prefs); }));
+        waitUntilBuilt.exec();
+        QApplication::restoreOverrideCursor();
+        _building = false;
+        if(candidates.buildCancelled())
+        {
+            _matches.clear();
+            return;
+        }
+    }
+    candidates.useSsimBlockSize(_prefs._ssimBlockSize);
+
+    const int needed = _prefs._comparisonMode == _prefs._PHASH? _prefs._thresholdPhash :
+                                                                qMax(_prefs._thresholdPhash, Candidates::_ssimGate);
+    auto pairKey = [](const int &left, const int &right)
+        { return static_cast<quint64>(left) << 32 | static_cast<quint64>(right); };
+    QSet<quint64> audioMatches;                     //pair matching both ways is exported once
+    if(exportFile)
+        for(const auto &candidate : candidates.audioPairs())
+            audioMatches << pairKey(candidate.left, candidate.right);
+    int exported = 0;
+    auto exportMatch = [&](const Match &match)
+    {
+        exportFile->write(_session, match.left, match.right, match.distance, match.ssim);
+        if(++exported % _exportFlushPairs == 0)
+            exportFile->flush();
+    };
+
+    _matches.clear();
+    for(auto &candidate : candidates.pairs())
+    {
+        if(64 - candidate.bestDistance() + _prefs._sameDurationModifier < needed)
+            break;                                  //sorted by distance, rest can not match either
+        double ssimSimilarity = -1;
+        if(candidateMatches(candidate, ssimSimilarity))
+        {
+            Match match;
+            match.left = candidate.left;
+            match.right = candidate.right;
+            match.distance = candidate.bestDistance();
+            match.ssim = ssimSimilarity;
+            _matches << match;
+            if(exportFile)
+            {
+                exportMatch(match);
+                audioMatches.remove(pairKey(match.left, match.right));
             }
+        }
+    }
+    for(const auto &candidate : candidates.audioPairs())   //matching sound is enough, whatever the picture
+    {
+        Match match;
+        match.left = candidate.left;
+        match.right = candidate.right;
+        match.distance = qMin(candidate.bestDistance(), 64);
+        _matches << match;
+        if(exportFile && audioMatches.contains(pairKey(match.left, match.right)))
+            exportMatch(match);
+    }
+    if(exportFile)
+        exportFile->flush();
 
-    if(foundMatches)
-        emit sendStatusMessage(QStringLiteral("\n[%1] Found %2 video(s) (%3) with one or more matches")
-             .arg(QTime::currentTime().toString()).arg(foundMatches).arg(readableFileSize(combinedFilesize)));
+    std::stable_sort(_matches.begin(), _matches.end());     //pair matching both ways is kept with its SSIM score
+    _matches.erase(std::unique(_matches.begin(), _matches.end(), [](const Match &a, const Match &b)
+                               { return a.left == b.left && a.right == b.right; }), _matches.end());
+}
+
+bool Comparison::candidateMatches(Candidate &candidate, double &ssimSimilarity)
+{
+    const int modifier = durationModifier(candidate.sameDuration);
+    int similarity = 0;
+
+    const int hashes = _prefs._thumbnails == cutEnds? 2 : 1;
+    for(int hash=0; hash<hashes; hash++)
+    {                               //if cutEnds mode: similarity is always the best one of both comparisons
+        similarity = qMax(similarity, qMin(64 - candidate.distance[hash] + modifier, 64));
+        if(_prefs._comparisonMode == _prefs._PHASH)
+        {
+            if(similarity >= _prefs._thresholdPhash)
+                return true;
+        }                           //ssim comparison is slow, only do it if pHash differs at most 20 bits of 64
+        else if(similarity >= qMax(_prefs._thresholdPhash, Candidates::_ssimGate))
+        {
+            if(candidate.ssim[hash] < 0)            //kept for later threshold changes
+                candidate.ssim[hash] = static_cast<float>(ssim(_session.grayThumb(candidate.left, hash),
+                                                               _session.grayThumb(candidate.right, hash),
+                                                               _prefs._ssimBlockSize));
+            ssimSimilarity = candidate.ssim[hash] + modifier / 64.0;    // b/64 bits (phash) <=> p/100 % (ssim)
+            if(ssimSimilarity > _prefs._thresholdSSIM)
+                return true;
+        }
+    }
+    return false;
+}
+
+int Comparison::durationModifier(const bool &sameDuration) const
+{
+    if(sameDuration)
+        return 0 + _prefs._sameDurationModifier;        //lower distance if both durations within 1s
+    return 0 - _prefs._differentDurationModifier;       //raise distance if both durations differ 1s
+}
+
+void Comparison::groupMatches()
+{
+    QVector<int> parent(_session.count());          //union-find: every matching pair joins two groups into one
+    for(int video=0; video<parent.count(); video++)
+        parent[video] = video;
+    for(const auto &match : _matches)
+        parent[groupRoot(parent, match.right)] = groupRoot(parent, match.left);
+
+    QHash< int, QVector<int> > members;
+    for(int video=0; video<parent.count(); video++)
+        members[groupRoot(parent, video)] << video;
+
+    _groups.clear();                                //in order of their first video, videos without match left out
+    for(int video=0; video<parent.count(); video++)
+    {
+        const QVector<int> &group = members[groupRoot(parent, video)];
+        if(group.count() > 1 && group.first() == video)
+            _groups << group;
+    }
+}
+
+int Comparison::groupRoot(QVector<int> &parent, int video) const
+{
+    while(parent[video] != video)
+    {
+        parent[video] = parent[parent[video]];      //path halving keeps the trees flat
+        video = parent[video];
+    }
+    return video;
+}
+
+void Comparison::reportGroups() const
+{
+    if(_groups.isEmpty())
+        return;
+
+    int64_t reclaimable = 0;
+    int matchingVideos = 0;
+    QMap<int, int> groupSizes;
+    for(const auto &group : _groups)
+    {
+        int64_t groupSize = 0, largestSize = 0;     //largest video of group is likely the one to be kept
+        for(const auto &video : group)
+        {
+            groupSize += _session.size(video);
+            largestSize = qMax(largestSize, _session.size(video));
+        }
+        reclaimable += groupSize - largestSize;
+        matchingVideos += group.count();
+        groupSizes[group.count()]++;
+    }
+
+    QString sizes;
+    for(auto size=groupSizes.cbegin(); size!=groupSizes.cend(); size++)
+        sizes += QStringLiteral("%1%2 x %3 videos").arg(sizes.isEmpty()? QStringLiteral("") : QStringLiteral(", "))
+                                                   .arg(size.value()).arg(size.key());
+    emit sendStatusMessage(QStringLiteral("\n[%1] Found %2 video(s) in %3 group(s) of matching videos (%4)\n"
+                                          "Keeping one video of each group frees %5")
+         .arg(QTime::currentTime().toString()).arg(matchingVideos).arg(_groups.count())
+         .arg(sizes, readableFileSize(reclaimable)));
 }
 
 void Comparison::confirmToExit()
@@ -79,154 +275,210 @@ void Comparison::confirmToExit()
 void Comparison::on_prevVideo_clicked()
 {
     _seekForwards = false;
-    QVector<Video*>::const_iterator left, right, begin = _videos.cbegin();
-    for(_rightVideo--, left=begin+_leftVideo; left>=begin; left--, _leftVideo--)
-    {
-        for(right=begin+_rightVideo; right>left; right--, _rightVideo--)
-            if(bothVideosMatch(*left, *right) && QFileInfo::exists((*left)->filename) && QFileInfo::exists((*right)->filename))
-            {
-                showVideo(QStringLiteral("left"));
-                showVideo(QStringLiteral("right"));
-                highlightBetterProperties();
-                updateUI();
-                return;
-            }
-        ui->progressBar->setValue(comparisonsSoFar());
-        _rightVideo = _prefs._numberOfVideos - 1;
-    }
-
-    on_nextVideo_clicked();     //went over limit, go forwards until first match
+    if(!showMatch(-1))
+        on_nextVideo_clicked();     //went over limit, go forwards until first match
 }
 
 void Comparison::on_nextVideo_clicked()
 {
     _seekForwards = true;
-    const int oldLeft = _leftVideo;
-    const int oldRight = _rightVideo;
+    if(!showMatch(1))
+        confirmToExit();            //went over limit, stay at last matching pair
+}
+
+int Comparison::shownPosition() const
+{                                   //pair shown may have been filtered out, then position of next one
+    Match shown;
+    shown.left = _leftVideo;
+    shown.right = _rightVideo;
+    return static_cast<int>(std::lower_bound(_matches.cbegin(), _matches.cend(), shown) - _matches.cbegin());
+}
+
+bool Comparison::showMatch(const int &step)
+{                                   //pairs are looked up from the one shown
+    int match = shownPosition();
+    if(step > 0 && match < _matches.count() && _matches[match].left == _leftVideo && _matches[match].right == _rightVideo)
+        match++;
+    if(step < 0)
+        match--;
 
-    QVector<Video*>::const_iterator left, right, begin = _videos.cbegin(), end = _videos.cend();
-    for(left=begin+_leftVideo; left<end; left++, _leftVideo++)
+    for(; match>=0 && match<_matches.count(); match+=step)
     {
-        for(_rightVideo++, right=begin+_rightVideo; right<end; right++, _rightVideo++)
-            if(bothVideosMatch(*left, *right) && QFileInfo::exists((*left)->filename) && QFileInfo::exists((*right)->filename))
-            {
-                showVideo(QStringLiteral("left"));
-                showVideo(QStringLiteral("right"));
-                highlightBetterProperties();
-                updateUI();
-                return;
-            }
-        ui->progressBar->setValue(comparisonsSoFar());
-        _rightVideo = _leftVideo + 1;
+        if(!QFileInfo::exists(_session.filename(_matches[match].left)) ||
+           !QFileInfo::exists(_session.filename(_matches[match].right)))
+            continue;
+
+        _match = match;
+        _leftVideo = _matches[match].left;
+        _rightVideo = _matches[match].right;
+        _phashSimilarity = 64 - _matches[match].distance;
+        if(!_matchesImported)
+            _phashSimilarity = qMin(_phashSimilarity + durationModifier(qAbs(_session.duration(_leftVideo) -
+                                                                             _session.duration(_rightVideo)) <= 1000), 64);
+        _ssimSimilarity = _matches[match].ssim;
+        showVideo(_left, _leftVideo);
+        showVideo(_right, _rightVideo);
+        highlightBetterProperties();
+        updateUI();
+        prefetchThumbnails();
+        prefetchZoom();
+        return true;
     }
+    return false;
+}
 
-    _leftVideo = oldLeft;       //went over limit, go to last matching pair
-    _rightVideo = oldRight;
-    confirmToExit();
+void Comparison::prefetchZoom()
+{                                   //full resolution captures are taken while user looks at pair, ready when zooming
+    collectZoomCaptures();
+    captureZoom(_leftVideo, true);
+    captureZoom(_rightVideo, true);
+    const int next = _match + (_seekForwards? 1 : -1);
+    if(next >= 0 && next < _matches.count())
+    {
+        captureZoom(_matches[next].left, true);
+        captureZoom(_matches[next].right, true);
+    }
 }
 
-bool Comparison::bothVideosMatch(const Video *left, const Video *right)
+void Comparison::captureZoom(const int &video, const bool &prefetch)
 {
-    bool theyMatch = false;
-    _phashSimilarity = 0;
+    if(_zoomCache.contains(video) || _zoomCaptures.contains(video))
+        return;
+    if(prefetch && _zoomCaptures.count() >= _zoomCaptureThreads)
+        return;                     //clicking through pairs quickly must not queue up captures of pairs passed by
 
-    const int hashes = _prefs._thumbnails == cutEnds? 2 : 1;
-    for(int hash=0; hash<hashes; hash++)
-    {                               //if cutEnds mode: similarity is always the best one of both comparisons
-        _phashSimilarity = qMax( _phashSimilarity, phashSimilarity(left, right, hash));
-        if(_prefs._comparisonMode == _prefs._PHASH)
-        {
-            if(_phashSimilarity >= _prefs._thresholdPhash)
-                theyMatch = true;
-        }                           //ssim comparison is slow, only do it if pHash differs at most 20 bits of 64
-        else if(_phashSimilarity >= qMax(_prefs._thresholdPhash, 44))
+    const QString filename = _session.filename(video);
+    const int64_t duration = _session.duration(video);
+    _zoomCaptures.insert(video, QtConcurrent::run(&_zoomPool, [this, filename, duration]()
+                                                  { return Video::captureAt(filename, duration, 10, 100, &_zoomCancelled); }));
+}
+
+void Comparison::collectZoomCaptures()
+{
+    for(auto capture=_zoomCaptures.begin(); capture!=_zoomCaptures.end();)
+    {
+        if(!capture.value().isFinished())
         {
-            _ssimSimilarity = ssim(left->grayThumb[hash], right->grayThumb[hash], _prefs._ssimBlockSize);
-            _ssimSimilarity = _ssimSimilarity + _durationModifier / 64.0;   // b/64 bits (phash) <=> p/100 % (ssim)
-            if(_ssimSimilarity > _prefs._thresholdSSIM)
-                theyMatch = true;
+            capture++;
+            continue;
         }
-        if(theyMatch)               //if cutEnds mode: first comparison matched already, skip second
-            break;
+        if(!capture.value().result().isNull())      //failed capture is tried again when zooming
+            _zoomCache.insert(capture.key(), new QImage(capture.value().result()));
+        capture = _zoomCaptures.erase(capture);
     }
-    return theyMatch;
 }
 
-int Comparison::phashSimilarity(const Video *left, const Video *right, const int &nthHash)
+QImage Comparison::zoomFrame(const int &video)
 {
-    if(left->hash[nthHash] == 0 && right->hash[nthHash] == 0)
-        return 0;
+    collectZoomCaptures();
+    if(const QImage *cached = _zoomCache.object(video))
+        return *cached;
+
+    captureZoom(video, false);
+    const QImage image = _zoomCaptures.take(video).result();       //waits if still running
+    if(!image.isNull())
+        _zoomCache.insert(video, new QImage(image));
+    return image;
+}
 
-    int distance = 64;
-    uint64_t differentBits = left->hash[nthHash] ^ right->hash[nthHash];    //XOR to value (only ones for differing bits)
-    while(differentBits)
-    {
-        differentBits &= differentBits - 1;                 //count number of bits of value
-        distance--;
-    }
+void Comparison::showVideo(const VideoLabels &labels, const int &thisVideo)
+{
+    labels.image->setPixmap(thumbnail(thisVideo, labels.image));
+
+    const QString filename = _session.filename(thisVideo);
+    labels.fileName->setText(QFileInfo(filename).fileName());
+    labels.fileName->setToolTip(QStringLiteral("%1\nOpen in file manager").arg(QDir::toNativeSeparators(filename)));
+    labels.pathName->setText(QDir::toNativeSeparators(QFileInfo(filename).absolutePath()));
+
+    labels.fileSize->setText(readableFileSize(_session.size(thisVideo)));
+    labels.duration->setText(readableDuration(_session.duration(thisVideo)));
+    labels.modified->setText(_session.modified(thisVideo).toString(QStringLiteral("yyyy-MM-dd hh:mm:ss")));
+    labels.resolution->setText(QStringLiteral("%1x%2").arg(_session.width(thisVideo)).arg(_session.height(thisVideo)));
 
-    if( qAbs(left->duration - right->duration) <= 1000 )
-        _durationModifier = 0 + _prefs._sameDurationModifier;               //lower distance if both durations within 1s
+    const double fps = _session.framerate(thisVideo);
+    if(fps == 0.0)
+        labels.frameRate->clear();
     else
-        _durationModifier = 0 - _prefs._differentDurationModifier;          //raise distance if both durations differ 1s
+        labels.frameRate->setText(QStringLiteral("%1 FPS").arg(fps));
 
-    distance = distance + _durationModifier;
-    return distance > 64? 64 : distance;
+    labels.bitRate->setText(readableBitRate(_session.bitrate(thisVideo)));
+    labels.codec->setText(_session.codec(thisVideo));
+    labels.audio->setText(_session.audio(thisVideo));
 }
 
-void Comparison::showVideo(const QString &side) const
+quint64 Comparison::thumbnailKey(const int &video, const QSize &size)
 {
-    int thisVideo = _leftVideo;
-    if(side == QLatin1String("right"))
-        thisVideo = _rightVideo;
+    return static_cast<quint64>(video) << 32 | static_cast<quint64>(size.width() & 0xFFFF) << 16 |
+           static_cast<quint64>(size.height() & 0xFFFF);
+}
 
-    auto *Image = this->findChild<ClickableLabel *>(side + QStringLiteral("Image"));
-    QBuffer pixels(&_videos[thisVideo]->thumbnail);
+QImage Comparison::scaledThumbnail(const Session &session, const int &video, const QSize &size)
+{
     QImage image;
-    image.load(&pixels, QByteArrayLiteral("JPG"));
-    Image->setPixmap(QPixmap::fromImage(image).scaled(Image->width(), Image->height(), Qt::KeepAspectRatio));
-
-    auto *FileName = this->findChild<ClickableLabel *>(side + QStringLiteral("FileName"));
-    FileName->setText(QFileInfo(_videos[thisVideo]->filename).fileName());
-    FileName->setToolTip(QStringLiteral("%1\nOpen in file manager")
-                                        .arg(QDir::toNativeSeparators(_videos[thisVideo]->filename)));
-
-    QFileInfo videoFile(_videos[thisVideo]->filename);
-    auto *PathName = this->findChild<QLabel *>(side + QStringLiteral("PathName"));
-    PathName->setText(QDir::toNativeSeparators(videoFile.absolutePath()));
-
-    auto *FileSize = this->findChild<QLabel *>(side + QStringLiteral("FileSize"));
-    FileSize->setText(readableFileSize(_videos[thisVideo]->size));
-
-    auto *Duration = this->findChild<QLabel *>(side + QStringLiteral("Duration"));
-    Duration->setText(readableDuration(_videos[thisVideo]->duration));
+    image.loadFromData(session.thumbnail(video), "JPG");
+    return image.scaled(size, Qt::KeepAspectRatio);
+}
 
-    auto *Modified = this->findChild<QLabel *>(side + QStringLiteral("Modified"));
-    Modified->setText(_videos[thisVideo]->modified.toString(QStringLiteral("yyyy-MM-dd hh:mm:ss")));
+QPixmap Comparison::thumbnail(const int &video, const QLabel *label)
+{                                   //decoded and scaled once for each label size
+    collectThumbnails();
+    const quint64 key = thumbnailKey(video, label->size());
+    if(const QPixmap *cached = _thumbnailCache.object(key))
+        return *cached;
 
-    const QString resolutionString = QStringLiteral("%1x%2").
-                  arg(_videos[thisVideo]->width).arg(_videos[thisVideo]->height);
-    auto *Resolution = this->findChild<QLabel *>(side + QStringLiteral("Resolution"));
-    Resolution->setText(resolutionString);
+    const QPixmap pixmap = QPixmap::fromImage(scaledThumbnail(_session, video, label->size()));
+    _thumbnailCache.insert(key, new QPixmap(pixmap));
+    return pixmap;
+}
 
-    auto *FrameRate = this->findChild<QLabel *>(side + QStringLiteral("FrameRate"));
-    const double fps = _videos[thisVideo]->framerate;
-    if(fps == 0.0)
-        FrameRate->clear();
-    else
-        FrameRate->setText(QStringLiteral("%1 FPS").arg(fps));
+void Comparison::prefetchThumbnails()
+{                                   //next pairs in browsing direction are decoded while user looks at this one
+    collectThumbnails();
+    if(_thumbnailPrefetch.isRunning())
+        return;
 
-    auto *BitRate = this->findChild<QLabel *>(side + QStringLiteral("BitRate"));
-    BitRate->setText(readableBitRate(_videos[thisVideo]->bitrate));
+    QVector<int> videos;
+    QVector<QSize> sizes;
+    auto prefetch = [&](const int &video, const QLabel *label)
+    {
+        const quint64 key = thumbnailKey(video, label->size());
+        if(!_thumbnailCache.contains(key) && !_prefetchedKeys.contains(key))
+        {
+            _prefetchedKeys << key;
+            videos << video;
+            sizes << label->size();
+        }
+    };
+    const int step = _seekForwards? 1 : -1;
+    for(int match=_match+step, i=0; match>=0 && match<_matches.count() && i<_prefetchPairs; match+=step, i++)
+    {
+        prefetch(_matches[match].left, _left.image);
+        prefetch(_matches[match].right, _right.image);
+    }
+    if(videos.isEmpty())
+        return;
 
-    auto *Codec = this->findChild<QLabel *>(side + QStringLiteral("Codec"));
-    Codec->setText(_videos[thisVideo]->codec);
+    const Session &session = _session;
+    _thumbnailPrefetch = QtConcurrent::run([&session, videos, sizes]()
+    {
+        QVector<QImage> images;
+        for(int i=0; i<videos.count(); i++)
+            images << scaledThumbnail(session, videos[i], sizes[i]);
+        return images;
+    });
+}
 
-    auto *Audio = this->findChild<QLabel *>(side + QStringLiteral("Audio"));
-    Audio->setText(_videos[thisVideo]->audio);
+void Comparison::collectThumbnails()
+{                                   //pixmaps can only be made in GUI thread
+    if(_prefetchedKeys.isEmpty() || !_thumbnailPrefetch.isFinished())
+        return;
+    const QVector<QImage> images = _thumbnailPrefetch.result();
+    for(int i=0; i<images.count(); i++)
+        _thumbnailCache.insert(_prefetchedKeys[i], new QPixmap(QPixmap::fromImage(images[i])));
+    _prefetchedKeys.clear();
 }
 
-QString Comparison::readableDuration(const int64_t &milliseconds) const
+QString Comparison::readableDuration(const int64_t &milliseconds)
 {
     if(milliseconds == 0)
         return QStringLiteral("");
@@ -246,7 +498,7 @@ QString Comparison::readableDuration(const int64_t &milliseconds) const
     return readableDuration;
 }
 
-QString Comparison::readableFileSize(const int64_t &filesize) const
+QString Comparison::readableFileSize(const int64_t &filesize)
 {
     if(filesize < 1024 * 1024)
         return(QStringLiteral("%1 kB").arg(QString::number(filesize / 1024.0, 'i', 0))); //even kBs
@@ -256,7 +508,7 @@ QString Comparison::readableFileSize(const int64_t &filesize) const
         return QStringLiteral("%1 GB").arg(QString::number(filesize / (1024.0 * 1024.0 * 1024.0), 'f', 1));
 }
 
-QString Comparison::readableBitRate(const double &kbps) const
+QString Comparison::readableBitRate(const double &kbps)
 {
     if(kbps == 0.0)
         return QStringLiteral("");
@@ -267,78 +519,78 @@ void Comparison::highlightBetterProperties() const
 {
     ui->leftFileSize->setStyleSheet(QStringLiteral(""));
     ui->rightFileSize->setStyleSheet(QStringLiteral(""));       //both filesizes within 100 kb
-    if(qAbs(_videos[_leftVideo]->size - _videos[_rightVideo]->size) <= 1024*100)
+    if(qAbs(_session.size(_leftVideo) - _session.size(_rightVideo)) <= 1024*100)
     {
         ui->leftFileSize->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
         ui->rightFileSize->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
     }
-    else if(_videos[_leftVideo]->size > _videos[_rightVideo]->size)
+    else if(_session.size(_leftVideo) > _session.size(_rightVideo))
         ui->leftFileSize->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
-    else if(_videos[_leftVideo]->size < _videos[_rightVideo]->size)
+    else if(_session.size(_leftVideo) < _session.size(_rightVideo))
         ui->rightFileSize->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
 
     ui->leftDuration->setStyleSheet(QStringLiteral(""));
     ui->rightDuration->setStyleSheet(QStringLiteral(""));       //both runtimes within 1 second
-    if(qAbs(_videos[_leftVideo]->duration - _videos[_rightVideo]->duration) <= 1000)
+    if(qAbs(_session.duration(_leftVideo) - _session.duration(_rightVideo)) <= 1000)
     {
         ui->leftDuration->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
         ui->rightDuration->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
     }
-    else if(_videos[_leftVideo]->duration > _videos[_rightVideo]->duration)
+    else if(_session.duration(_leftVideo) > _session.duration(_rightVideo))
         ui->leftDuration->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
-    else if(_videos[_leftVideo]->duration < _videos[_rightVideo]->duration)
+    else if(_session.duration(_leftVideo) < _session.duration(_rightVideo))
         ui->rightDuration->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
 
     ui->leftBitRate->setStyleSheet(QStringLiteral(""));
     ui->rightBitRate->setStyleSheet(QStringLiteral(""));
-    if(_videos[_leftVideo]->bitrate == _videos[_rightVideo]->bitrate)
+    if(_session.bitrate(_leftVideo) == _session.bitrate(_rightVideo))
     {
         ui->leftBitRate->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
         ui->rightBitRate->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
     }
-    else if(_videos[_leftVideo]->bitrate > _videos[_rightVideo]->bitrate)
+    else if(_session.bitrate(_leftVideo) > _session.bitrate(_rightVideo))
         ui->leftBitRate->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
-    else if(_videos[_leftVideo]->bitrate < _videos[_rightVideo]->bitrate)
+    else if(_session.bitrate(_leftVideo) < _session.bitrate(_rightVideo))
         ui->rightBitRate->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
 
     ui->leftFrameRate->setStyleSheet(QStringLiteral(""));
     ui->rightFrameRate->setStyleSheet(QStringLiteral(""));      //both framerates within 0.1 fps
-    if(qAbs(_videos[_leftVideo]->framerate - _videos[_rightVideo]->framerate) <= 0.1)
+    if(qAbs(_session.framerate(_leftVideo) - _session.framerate(_rightVideo)) <= 0.1)
     {
         ui->leftFrameRate->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
         ui->rightFrameRate->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
     }
-    else if(_videos[_leftVideo]->framerate > _videos[_rightVideo]->framerate)
+    else if(_session.framerate(_leftVideo) > _session.framerate(_rightVideo))
         ui->leftFrameRate->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
-    else if(_videos[_leftVideo]->framerate < _videos[_rightVideo]->framerate)
+    else if(_session.framerate(_leftVideo) < _session.framerate(_rightVideo))
         ui->rightFrameRate->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
 
     ui->leftModified->setStyleSheet(QStringLiteral(""));
     ui->rightModified->setStyleSheet(QStringLiteral(""));
-    if(_videos[_leftVideo]->modified == _videos[_rightVideo]->modified)
+    if(_session.modified(_leftVideo) == _session.modified(_rightVideo))
     {
         ui->leftModified->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
         ui->rightModified->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
     }
-    else if(_videos[_leftVideo]->modified < _videos[_rightVideo]->modified)
+    else if(_session.modified(_leftVideo) < _session.modified(_rightVideo))
         ui->leftModified->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
-    else if(_videos[_leftVideo]->modified > _videos[_rightVideo]->modified)
+    else if(_session.modified(_leftVideo) > _session.modified(_rightVideo))
         ui->rightModified->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
 
     ui->leftResolution->setStyleSheet(QStringLiteral(""));
     ui->rightResolution->setStyleSheet(QStringLiteral(""));
 
-    if(_videos[_leftVideo]->width * _videos[_leftVideo]->height ==
-       _videos[_rightVideo]->width * _videos[_rightVideo]->height)
+    if(_session.width(_leftVideo) * _session.height(_leftVideo) ==
+       _session.width(_rightVideo) * _session.height(_rightVideo))
     {
         ui->leftResolution->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
         ui->rightResolution->setStyleSheet(QStringLiteral("QLabel { color : peru; }"));
     }
-    else if(_videos[_leftVideo]->width * _videos[_leftVideo]->height >
-       _videos[_rightVideo]->width * _videos[_rightVideo]->height)
+    else if(_session.width(_leftVideo) * _session.height(_leftVideo) >
+       _session.width(_rightVideo) * _session.height(_rightVideo))
         ui->leftResolution->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
-    else if(_videos[_leftVideo]->width * _videos[_leftVideo]->height <
-            _videos[_rightVideo]->width * _videos[_rightVideo]->height)
+    else if(_session.width(_leftVideo) * _session.height(_leftVideo) <
+            _session.width(_rightVideo) * _session.height(_rightVideo))
         ui->rightResolution->setStyleSheet(QStringLiteral("QLabel { color : green; }"));
 }
 
@@ -355,21 +607,12 @@ void Comparison::updateUI()
         ui->rightMove->setDisabled(false);
     }
 
-    if(_prefs._comparisonMode == _prefs._PHASH)
+    if(_prefs._comparisonMode == _prefs._PHASH || _ssimSimilarity < 0)     //imported pair may have no SSIM
         ui->identicalBits->setText(QString("%1/64 same bits").arg(_phashSimilarity));
-    if(_prefs._comparisonMode == _prefs._SSIM)
+    else
         ui->identicalBits->setText(QString("%1 SSIM index").arg(QString::number(qMin(_ssimSimilarity, 1.0), 'f', 3)));
     _zoomLevel = 0;
-    ui->progressBar->setValue(comparisonsSoFar());
-}
-
-int Comparison::comparisonsSoFar() const
-{
-    const int cmpFirst = _prefs._numberOfVideos;                    //comparisons done for first video
-    const int cmpThis = cmpFirst - _leftVideo;                      //comparisons done for current video
-    const int remaining = cmpThis * (cmpThis - 1) / 2;              //comparisons for remaining videos
-    const int maxComparisons = cmpFirst * (cmpFirst - 1) / 2;       //comparing all videos with each other
-    return maxComparisons - remaining + _rightVideo - _leftVideo;
+    ui->progressBar->setValue(_match + 1);
 }
 
 void Comparison::openFileManager(const QString &filename) const
@@ -387,7 +630,7 @@ void Comparison::openFileManager(const QString &filename) const
 
 void Comparison::deleteVideo(const int &side)
 {
-    const QString filename = _videos[side]->filename;
+    const QString filename = _session.filename(side);
     const QString onlyFilename = filename.right(filename.length() - filename.lastIndexOf("/") - 1);
     const Db cache(filename);                       //generate unique id before file has been deleted
     const QString id = cache.uniqueId();
@@ -405,7 +648,7 @@ void Comparison::deleteVideo(const int &side)
         else
         {
             _videosDeleted++;
-            _spaceSaved = _spaceSaved + _videos[side]->size;
+            _spaceSaved = _spaceSaved + _session.size(side);
             cache.removeVideo(id);
             emit sendStatusMessage(QString("Deleted %1").arg(QDir::toNativeSeparators(filename)));
             _seekForwards? on_nextVideo_clicked() : on_prevVideo_clicked();
@@ -440,13 +683,13 @@ void Comparison::moveVideo(const QString &from, const QString &to)
 
 void Comparison::on_swapFilenames_clicked() const
 {
-    const QFileInfo leftVideoFile(_videos[_leftVideo]->filename);
+    const QFileInfo leftVideoFile(_session.filename(_leftVideo));
     const QString leftPathname = leftVideoFile.absolutePath();
     const QString oldLeftFilename = leftVideoFile.fileName();
     const QString oldLeftNoExtension = oldLeftFilename.left(oldLeftFilename.lastIndexOf("."));
     const QString leftExtension = oldLeftFilename.right(oldLeftFilename.length() - oldLeftFilename.lastIndexOf("."));
 
-    const QFileInfo rightVideoFile(_videos[_rightVideo]->filename);
+    const QFileInfo rightVideoFile(_session.filename(_rightVideo));
     const QString rightPathname = rightVideoFile.absolutePath();
     const QString oldRightFilename = rightVideoFile.fileName();
     const QString oldRightNoExtension = oldRightFilename.left(oldRightFilename.lastIndexOf("."));
@@ -458,23 +701,31 @@ void Comparison::on_swapFilenames_clicked() const
     const QString newRightFilename = QStringLiteral("%1%2").arg(oldLeftNoExtension, rightExtension);
     const QString newRightPathAndFilename = QStringLiteral("%1/%2").arg(rightPathname, newRightFilename);
 
-    QFile leftFile(_videos[_leftVideo]->filename);                  //rename files
-    QFile rightFile(_videos[_rightVideo]->filename);
+    QFile leftFile(_session.filename(_leftVideo));                  //rename files
+    QFile rightFile(_session.filename(_rightVideo));
     leftFile.rename(QStringLiteral("%1/VidupeRenamedVideo.avi").arg(leftPathname));
     rightFile.rename(newRightPathAndFilename);
     leftFile.rename(newLeftPathAndFilename);
 
-    _videos[_leftVideo]->filename = newLeftPathAndFilename;         //update filename in object
-    _videos[_rightVideo]->filename = newRightPathAndFilename;
+    _session.setFilename(_leftVideo, newLeftPathAndFilename);       //update filename in session
+    _session.setFilename(_rightVideo, newRightPathAndFilename);
 
     ui->leftFileName->setText(newLeftFilename);                     //update UI
     ui->rightFileName->setText(newRightFilename);
 
-    Db cache(_videos[_leftVideo]->filename);
+    Db cache(_session.filename(_leftVideo));
     cache.removeVideo(cache.uniqueId(oldLeftFilename));             //remove both videos from cache
     cache.removeVideo(cache.uniqueId(oldRightFilename));
 }
 
+void Comparison::on_showGroups_clicked()
+{
+    GroupView groupView(_session, _groups, _matches, _prefs);
+    groupView.exec();
+    if(!QFileInfo::exists(_session.filename(_leftVideo)) || !QFileInfo::exists(_session.filename(_rightVideo)))
+        _seekForwards? on_nextVideo_clicked() : on_prevVideo_clicked();     //pair shown was deleted in group view
+}
+
 void Comparison::on_thresholdSlider_valueChanged(const int &value)
 {
     _prefs._thresholdSSIM = value / 100.0;
@@ -487,9 +738,25 @@ void Comparison::on_thresholdSlider_valueChanged(const int &value)
                 "Larger: more strict, can miss identical videos (false negative)").arg(value).arg(matchingBitsOf64);
     ui->thresholdSlider->setToolTip(thresholdMessage);
 
+    updateMatches();
+    if(!_matchesImported)
+        ui->thresholdSlider->setToolTip(QStringLiteral("%1\n%2 matching pair(s)").arg(thresholdMessage).arg(_matches.count()));
+
     emit adjustThresholdSlider(ui->thresholdSlider->value());
 }
 
+void Comparison::updateMatches()
+{
+    if(_matchesImported || !isVisible())            //pairs are filtered in constructor when opening
+        return;
+    filterCandidates();                             //stored distances are filtered again, no fingerprints compared
+    groupMatches();
+    enableGroups();
+    _match = shownPosition();
+    ui->progressBar->setMaximum(_matches.count());
+    ui->progressBar->setValue(_match + 1);
+}
+
 void Comparison::resizeEvent(QResizeEvent *event)
 {
     Q_UNUSED(event)
@@ -497,15 +764,8 @@ void Comparison::resizeEvent(QResizeEvent *event)
     if(ui->leftFileName->text().isEmpty() || _leftVideo >= _prefs._numberOfVideos || _rightVideo >= _prefs._numberOfVideos)
         return;     //automatic initial resize event can happen before closing when values went over limit
 
-    QImage image;
-    QBuffer leftPixels(&_videos[_leftVideo]->thumbnail);
-    image.load(&leftPixels, QByteArrayLiteral("JPG"));
-    ui->leftImage->setPixmap(QPixmap::fromImage(image).scaled(
-                             ui->leftImage->width(), ui->leftImage->height(), Qt::KeepAspectRatio));
-    QBuffer rightPixels(&_videos[_rightVideo]->thumbnail);
-    image.load(&rightPixels, QByteArrayLiteral("JPG"));
-    ui->rightImage->setPixmap(QPixmap::fromImage(image).scaled(
-                              ui->rightImage->width(), ui->rightImage->height(), Qt::KeepAspectRatio));
+    ui->leftImage->setPixmap(thumbnail(_leftVideo, ui->leftImage));
+    ui->rightImage->setPixmap(thumbnail(_rightVideo, ui->rightImage));
 }
 
 void Comparison::wheelEvent(QWheelEvent *event)
@@ -535,16 +795,18 @@ void Comparison::wheelEvent(QWheelEvent *event)
     if(_zoomLevel == 0)     //first mouse wheel movement: retrieve actual screen captures in full resolution
     {
         QApplication::setOverrideCursor(Qt::WaitCursor);
+        captureZoom(_leftVideo, false);             //usually prefetched, else both captured at same time
+        captureZoom(_rightVideo, false);
 
         QImage image;
-        image = _videos[_leftVideo]->captureAt(10);
+        image = zoomFrame(_leftVideo);
         ui->leftImage->setPixmap(QPixmap::fromImage(image).scaled(
                                  ui->leftImage->width(), ui->leftImage->height(), Qt::KeepAspectRatio));
         _leftZoomed = QPixmap::fromImage(image);      //keep it in memory
         _leftW = image.width();
         _leftH = image.height();
 
-        image = _videos[_rightVideo]->captureAt(10);
+        image = zoomFrame(_rightVideo);
         ui->rightImage->setPixmap(QPixmap::fromImage(image).scaled(
                                   ui->rightImage->width(), ui->rightImage->height(), Qt::KeepAspectRatio));
         _rightZoomed = QPixmap::fromImage(image);
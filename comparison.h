@@ -5,22 +5,34 @@
 #include <QDesktopServices>
 #include <QUrl>
 #include <QLabel>
+#include <QCache>
+#include <QFuture>
+#include <QThreadPool>
 #include "video.h"
+#include "session.h"
+#include "matchfile.h"
 
 namespace Ui { class Comparison; }
 
+class ClickableLabel;
+
 class Comparison : public QDialog
 {
     Q_OBJECT
 
 public:
-    Comparison(const QVector<Video *> &videosParam, const Prefs &prefsParam);
+    Comparison(Session &sessionParam, const Prefs &prefsParam,
+               const QVector<Match> &importedParam = QVector<Match>());
     ~Comparison();
 
+    static QString readableDuration(const int64_t &milliseconds);
+    static QString readableFileSize(const int64_t &filesize);
+    static QString readableBitRate(const double &kbps);
+
 private:
     Ui::Comparison *ui;
 
-    QVector<Video *> _videos;
+    Session &_session;
     Prefs _prefs;
     int _leftVideo = 0;
     int _rightVideo = 0;
@@ -28,11 +40,41 @@ private:
     int64_t _spaceSaved = 0;
     bool _seekForwards = true;
 
-    int _durationModifier = 0;
     int _phashSimilarity = 0;
     double _ssimSimilarity = 0.0;
 
+    QVector<Match> _matches;                        //pairs shown, sorted by left and right video
+    int _match = -1;
+    bool _matchesImported;                          //pairs read from file are shown as such, without comparing
+    bool _building = false;                         //pairs compared again in background for a lower threshold
+
+    QVector< QVector<int> > _groups;                //matching videos clustered together (indexes of _session)
+
+    static constexpr int _exportFlushPairs = 1000;  //matching pairs saved to file are flushed this often
+
+    static constexpr int _zoomCacheFrames = 6;      //full resolution captures kept in memory, for about three pairs
+    static constexpr int _zoomCaptureThreads = 4;   //both videos of pair shown and of next pair at same time
+
+    struct VideoLabels                              //labels of one side, looked up once
+    {
+        ClickableLabel *image, *fileName;
+        QLabel *pathName, *fileSize, *duration, *modified, *resolution, *frameRate, *bitRate, *codec, *audio;
+    };
+    VideoLabels _left;
+    VideoLabels _right;
+
+    static constexpr int _thumbnailCacheSize = 64;  //decoded thumbnails kept, scaled to size of label
+    static constexpr int _prefetchPairs = 8;        //thumbnails of this many following pairs are decoded in advance
+
+    QCache<quint64, QPixmap> _thumbnailCache;       //by thumbnailKey()
+    QFuture< QVector<QImage> > _thumbnailPrefetch;  //decoded in background, turned into pixmaps when done
+    QVector<quint64> _prefetchedKeys;
+
     int _zoomLevel = 0;
+    QCache<int, QImage> _zoomCache;                 //full resolution captures by video, least recently used dropped
+    QHash<int, QFuture<QImage> > _zoomCaptures;     //captures still running in background
+    QThreadPool _zoomPool;
+    std::atomic<bool> _zoomCancelled { false };     //kills ffmpeg of running captures when closing
     QPixmap _leftZoomed;
     int _leftW = 0;
     int _leftH = 0;
@@ -40,46 +82,62 @@ private:
     int _rightW = 0;
     int _rightH = 0;
 
+    void filterCandidates(MatchFile *exportFile = nullptr);
+    bool candidateMatches(Candidate &candidate, double &ssimSimilarity);
+    int durationModifier(const bool &sameDuration) const;
+    void groupMatches();
+    int groupRoot(QVector<int> &parent, int video) const;
+    void reportGroups() const;
+    int shownPosition() const;
+    bool showMatch(const int &step);
+    void showVideo(const VideoLabels &labels, const int &thisVideo);
+    QPixmap thumbnail(const int &video, const QLabel *label);
+    static quint64 thumbnailKey(const int &video, const QSize &size);
+    static QImage scaledThumbnail(const Session &session, const int &video, const QSize &size);
+    void prefetchThumbnails();
+    void collectThumbnails();
+    void prefetchZoom();
+    void captureZoom(const int &video, const bool &prefetch);
+    void collectZoomCaptures();
+    QImage zoomFrame(const int &video);
+
 public slots:
     void reportMatchingVideos();
 
 private slots:
     void confirmToExit();
+    void reject() { _session.candidates().cancelBuild(true); QDialog::reject(); }   //closed while comparing
     void on_prevVideo_clicked();
     void on_nextVideo_clicked();
-    bool bothVideosMatch(const Video *left, const Video *right);
-    int phashSimilarity(const Video *left, const Video *right, const int &nthHash);
 
-    void showVideo(const QString &side) const;
-    QString readableDuration(const int64_t &milliseconds) const;
-    QString readableFileSize(const int64_t &filesize) const;
-    QString readableBitRate(const double &kbps) const;
     void highlightBetterProperties() const;
     void updateUI();
-    int comparisonsSoFar() const;
 
     void on_selectPhash_clicked ( const bool &checked) { if(checked) _prefs._comparisonMode = _prefs._PHASH;
-                                                         emit switchComparisonMode(_prefs._comparisonMode); }
+                                                         updateMatches(); emit switchComparisonMode(_prefs._comparisonMode); }
     void on_selectSSIM_clicked ( const bool &checked) { if(checked) _prefs._comparisonMode = _prefs._SSIM;
-                                                        emit switchComparisonMode(_prefs._comparisonMode); }
+                                                        updateMatches(); emit switchComparisonMode(_prefs._comparisonMode); }
 
-    void on_leftImage_clicked() { QDesktopServices::openUrl(QUrl::fromLocalFile(_videos[_leftVideo]->filename)); }
-    void on_rightImage_clicked() { QDesktopServices::openUrl(QUrl::fromLocalFile(_videos[_rightVideo]->filename)); }
+    void on_leftImage_clicked() { QDesktopServices::openUrl(QUrl::fromLocalFile(_session.filename(_leftVideo))); }
+    void on_rightImage_clicked() { QDesktopServices::openUrl(QUrl::fromLocalFile(_session.filename(_rightVideo))); }
 
-    void on_leftFileName_clicked() { openFileManager(_videos[_leftVideo]->filename); }
-    void on_rightFileName_clicked() { openFileManager(_videos[_rightVideo]->filename); }
+    void on_leftFileName_clicked() { openFileManager(_session.filename(_leftVideo)); }
+    void on_rightFileName_clicked() { openFileManager(_session.filename(_rightVideo)); }
     void openFileManager(const QString &filename) const;
 
     void on_leftDelete_clicked() { deleteVideo(_leftVideo); }
     void on_rightDelete_clicked() { deleteVideo(_rightVideo); }
     void deleteVideo(const int &side);
 
-    void on_leftMove_clicked() { moveVideo(_videos[_leftVideo]->filename, _videos[_rightVideo]->filename); }
-    void on_rightMove_clicked() { moveVideo(_videos[_rightVideo]->filename, _videos[_leftVideo]->filename); }
+    void on_leftMove_clicked() { moveVideo(_session.filename(_leftVideo), _session.filename(_rightVideo)); }
+    void on_rightMove_clicked() { moveVideo(_session.filename(_rightVideo), _session.filename(_leftVideo)); }
     void moveVideo(const QString &from, const QString &to);
     void on_swapFilenames_clicked() const;
+    void on_showGroups_clicked();
+    void enableGroups() { ui->showGroups->setDisabled(_groups.isEmpty()); }
 
     void on_thresholdSlider_valueChanged(const int &value);
+    void updateMatches();
     void resizeEvent(QResizeEvent *event);
     void wheelEvent(QWheelEvent *event);
 
@@ -1,8 +1,16 @@
 #include <QApplication>
 #include <QCryptographicHash>
 #include <QSqlQuery>
+#include <QMutex>
 #include "db.h"
 #include "video.h"
+#include "pack.h"
+
+QString Db::_cacheFilename;
+constexpr int Db::_removeBatch;
+QHash<QString, bool> Db::_prepared;
+QHash<QString, Db::Metadata> Db::_preloaded;
+int Db::_preloadedAlgorithm = -1;
 
 Db::Db(const QString &filename)
 {
@@ -10,38 +18,236 @@ Db::Db(const QString &filename)
     _modified = file.lastModified();
     _connection = uniqueId(filename);       //connection name is unique (generated from full path+filename)
     _id = uniqueId(file.fileName());        //primary key remains same even if file is moved to other folder
+    _cacheFile = cacheFile();
+}
 
-    const QString dbfilename = QStringLiteral("%1/cache.db").arg(QApplication::applicationDirPath());
+Db::~Db()
+{
+    if(!_db.isValid())
+        return;
+    _db.close();
+    _db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(_connection);
+}
+
+QSqlDatabase &Db::database() const
+{
+    if(_db.isValid())
+        return _db;
     _db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), _connection);
-    _db.setDatabaseName(dbfilename);
+    _db.setDatabaseName(_cacheFile);
     _db.open();
 
-    createTables();
+    static QMutex preparing;                //tables are created once per cache file, not for every video
+    QMutexLocker lock(&preparing);
+    if(!_prepared.contains(_cacheFile))
+    {
+        createTables();
+        QSqlQuery query(_db);
+        query.exec(QStringLiteral("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'capture';"));
+        _prepared.insert(_cacheFile, query.next());
+    }
+    _legacyCaptures = _prepared.value(_cacheFile);
+    return _db;
+}
+
+QString Db::cacheFile()
+{
+    if(_cacheFilename.isEmpty())
+        return QStringLiteral("%1/cache.db").arg(QApplication::applicationDirPath());
+    return _cacheFilename;
+}
+
+bool Db::mergeCache(const QString &from)
+{
+    if(!QFileInfo::exists(from))
+        return false;
+
+    Db target(from);                                    //connection to cache file, creates tables if it is new
+    QSqlQuery query(target.database());
+    QString shard = from;
+    if(!query.exec(QStringLiteral("ATTACH DATABASE '%1' AS shard;").arg(shard.replace(QStringLiteral("'"), QStringLiteral("''")))))
+        return false;
+
+    QSqlQuery insert(target.database());
+    auto copyCapture = [&](const QString &id, const int &percent, const QByteArray &image)
+    {                                                   //captures missing from target are appended to its packs
+        insert.exec(QStringLiteral("SELECT 1 FROM capturePack WHERE id = '%1' AND percent = %2;").arg(id).arg(percent));
+        int pack;
+        qint64 start;
+        if(image.isEmpty() || insert.next() || !Pack::append(target._cacheFile, image, pack, start))
+            return;
+        insert.exec(QStringLiteral("INSERT INTO capturePack VALUES('%1', %2, %3, %4, %5);")
+                    .arg(id).arg(percent).arg(pack).arg(start).arg(image.size()));
+    };
+    const QString columns = QStringLiteral("id, size, duration, bitrate, framerate, codec, audio, width, height, cached");
+
+    target.database().transaction();
+    query.exec(QStringLiteral("INSERT OR REPLACE INTO metadata (%1) SELECT %1 FROM shard.metadata s WHERE NOT EXISTS "
+                              "(SELECT 1 FROM metadata m WHERE m.id = s.id AND m.cached >= s.cached);").arg(columns));
+    query.exec(QStringLiteral("SELECT id, percent, pack, start, length FROM shard.capturePack;"));
+    while(query.next())
+        copyCapture(query.value(0).toString(), query.value(1).toInt(),
+                    Pack::read(from, query.value(2).toInt(), query.value(3).toLongLong(), query.value(4).toInt()));
+    query.exec(QStringLiteral("SELECT 1 FROM shard.sqlite_master WHERE type = 'table' AND name = 'capture';"));
+    if(query.next())                                    //shard made by older version
+    {
+        const QVector<int> percentages = Thumbnail::allPercentages();
+        query.exec(QStringLiteral("SELECT * FROM shard.capture;"));
+        while(query.next())
+            for(int capture=0; capture<percentages.count(); capture++)
+                copyCapture(query.value(0).toString(), percentages[capture], query.value(capture + 1).toByteArray());
+    }
+    query.exec(QStringLiteral("INSERT OR IGNORE INTO capturePosition SELECT * FROM shard.capturePosition;"));
+    query.exec(QStringLiteral("INSERT OR IGNORE INTO frameHash SELECT * FROM shard.frameHash;"));
+    query.exec(QStringLiteral("INSERT OR IGNORE INTO audio SELECT * FROM shard.audio;"));
+    const bool merged = target.database().commit();
+
+    query.exec(QStringLiteral("DETACH DATABASE shard;"));
+    Pack::close(from);
+    return merged;
+}
+
+bool Db::compactCache()
+{
+    Db cache(cacheFile());
+    const QString file = cache._cacheFile;
+    Pack::close(file);
+    const int oldPacks = Pack::newest(file);
+    Pack::startNew(file);                               //live captures are copied to new packs, old ones deleted
+
+    QSqlQuery query(cache.database());
+    QSqlQuery update(cache.database());
+    auto moveCapture = [&](const QString &id, const int &percent, const QByteArray &image)
+    {
+        int pack;
+        qint64 start;
+        if(image.isEmpty() || !Pack::append(file, image, pack, start))
+            update.exec(QStringLiteral("DELETE FROM capturePack WHERE id = '%1' AND percent = %2;").arg(id).arg(percent));
+        else
+            update.exec(QStringLiteral("INSERT OR REPLACE INTO capturePack VALUES('%1', %2, %3, %4, %5);")
+                        .arg(id).arg(percent).arg(pack).arg(start).arg(image.size()));
+    };
+
+    cache.database().transaction();
+    query.exec(QStringLiteral("SELECT id, percent, pack, start, length FROM capturePack WHERE pack <= %1 "
+                              "ORDER BY pack, start;").arg(oldPacks));     //read in order packs were written
+    while(query.next())
+        moveCapture(query.value(0).toString(), query.value(1).toInt(),
+                    Pack::read(file, query.value(2).toInt(), query.value(3).toLongLong(), query.value(4).toInt()));
+    if(cache._legacyCaptures)
+    {
+        const QVector<int> percentages = Thumbnail::allPercentages();
+        query.exec(QStringLiteral("SELECT * FROM capture;"));
+        while(query.next())
+            for(int capture=0; capture<percentages.count(); capture++)
+                if(!query.value(capture + 1).isNull())
+                    moveCapture(query.value(0).toString(), percentages[capture], query.value(capture + 1).toByteArray());
+        query.exec(QStringLiteral("DROP TABLE capture;"));
+        _prepared.insert(file, false);
+    }
+    if(!cache.database().commit())
+    {
+        Pack::close(file);
+        return false;
+    }
+
+    Pack::close(file);
+    for(int pack=0; pack<=oldPacks; pack++)
+        QFile::remove(Pack::filename(file, pack));
+    query.exec(QStringLiteral("VACUUM;"));              //space of removed image rows is given back
+    return true;
+}
+
+void Db::preload(const int &algorithm)
+{
+    releasePreload();
+    const Db cache(cacheFile());
+    QSqlQuery query(cache.database());
+    query.setForwardOnly(true);                             //one pass, rows are not kept by driver
+
+    query.exec(QStringLiteral("SELECT id, size, duration, bitrate, framerate, codec, audio, width, height FROM metadata;"));
+    while(query.next())
+    {
+        Metadata &metadata = _preloaded[query.value(0).toString()];
+        metadata.size = query.value(1).toLongLong();
+        metadata.duration = query.value(2).toLongLong();
+        metadata.bitrate = query.value(3).toInt();
+        metadata.framerate = query.value(4).toDouble();
+        metadata.codec = query.value(5).toString();
+        metadata.audio = query.value(6).toString();
+        metadata.width = static_cast<short>(query.value(7).toInt());
+        metadata.height = static_cast<short>(query.value(8).toInt());
+    }
+
+    query.exec(QStringLiteral("SELECT id, percent, hash FROM frameHash WHERE algorithm = %1;").arg(algorithm));
+    while(query.next())
+    {
+        const auto metadata = _preloaded.find(query.value(0).toString());
+        const QByteArray hash = query.value(2).toByteArray();
+        if(metadata == _preloaded.end() || hash.size() != sizeof(Fingerprint))
+            continue;
+        metadata->frameHashes.append(static_cast<char>(query.value(1).toInt())).append(hash);
+    }
+
+    query.exec(QStringLiteral("SELECT id, percent, pack, start, length FROM capturePack;"));
+    while(query.next())
+    {
+        const auto metadata = _preloaded.find(query.value(0).toString());
+        if(metadata == _preloaded.end())
+            continue;
+        CaptureLocation capture;
+        capture.percent = query.value(1).toInt();
+        capture.pack = query.value(2).toInt();
+        capture.start = query.value(3).toLongLong();
+        capture.length = query.value(4).toInt();
+        metadata->captures << capture;
+    }
+    _preloadedAlgorithm = algorithm;
 }
 
 QString Db::uniqueId(const QString &filename) const
 {
     if(filename.isEmpty())
         return _id;
+    return idOf(filename, _modified);
+}
 
-    const QString name_modified = QStringLiteral("%1_%2").arg(filename)
-                                  .arg(_modified.toString(QStringLiteral("yyyy-MM-dd hh:mm:ss.zzz")));
+QString Db::videoId(const QString &filename)
+{
+    const QFileInfo file(filename);
+    return idOf(file.fileName(), file.lastModified());
+}
+
+QString Db::idOf(const QString &name, const QDateTime &modified)
+{
+    const QString name_modified = QStringLiteral("%1_%2").arg(name)
+                                  .arg(modified.toString(QStringLiteral("yyyy-MM-dd hh:mm:ss.zzz")));
     return QCryptographicHash::hash(name_modified.toLatin1(), QCryptographicHash::Md5).toHex();
 }
 
 void Db::createTables() const
 {
-    QSqlQuery query(_db);
+    QSqlQuery query(database());
     query.exec(QStringLiteral("PRAGMA synchronous = OFF;"));
     query.exec(QStringLiteral("PRAGMA journal_mode = WAL;"));
 
     query.exec(QStringLiteral("CREATE TABLE IF NOT EXISTS metadata (id TEXT PRIMARY KEY, "
                               "size INTEGER, duration INTEGER, bitrate INTEGER, framerate REAL, "
-                              "codec TEXT, audio TEXT, width INTEGER, height INTEGER);"));
+                              "codec TEXT, audio TEXT, width INTEGER, height INTEGER, cached INTEGER);"));
+    query.exec(QStringLiteral("ALTER TABLE metadata ADD COLUMN cached INTEGER DEFAULT 0;"));  //fails if already added
+
+    query.exec(QStringLiteral("CREATE TABLE IF NOT EXISTS capturePack (id TEXT, percent INTEGER, pack INTEGER, "
+                              "start INTEGER, length INTEGER, PRIMARY KEY (id, percent));"));
 
-    query.exec(QStringLiteral("CREATE TABLE IF NOT EXISTS capture (id TEXT PRIMARY KEY, "
-                              " at8 BLOB, at16 BLOB, at24 BLOB, at32 BLOB, at40 BLOB, at48 BLOB, "
-                              "at56 BLOB, at64 BLOB, at72 BLOB, at80 BLOB, at88 BLOB, at96 BLOB);"));
+    query.exec(QStringLiteral("CREATE TABLE IF NOT EXISTS capturePosition (id TEXT, percent INTEGER, position INTEGER, "
+                              "PRIMARY KEY (id, percent));"));
+
+    query.exec(QStringLiteral("CREATE TABLE IF NOT EXISTS frameHash (id TEXT, percent INTEGER, algorithm INTEGER, "
+                              "hash BLOB, PRIMARY KEY (id, percent, algorithm));"));
+
+    query.exec(QStringLiteral("CREATE TABLE IF NOT EXISTS audio (id TEXT, percent INTEGER, prints BLOB, "
+                              "PRIMARY KEY (id, percent));"));
 
     query.exec(QStringLiteral("CREATE TABLE IF NOT EXISTS version (version TEXT PRIMARY KEY);"));
     query.exec(QStringLiteral("INSERT OR REPLACE INTO version VALUES('%1');").arg(APP_VERSION));
@@ -49,7 +255,22 @@ void Db::createTables() const
 
 bool Db::readMetadata(Video &video) const
 {
-    QSqlQuery query(_db);
+    const auto preloaded = _preloaded.constFind(_id);
+    if(preloaded != _preloaded.cend())
+    {
+        video.modified = _modified;
+        video.size = preloaded->size;
+        video.duration = preloaded->duration;
+        video.bitrate = preloaded->bitrate;
+        video.framerate = preloaded->framerate;
+        video.codec = preloaded->codec;
+        video.audio = preloaded->audio;
+        video.width = preloaded->width;
+        video.height = preloaded->height;
+        return true;
+    }
+
+    QSqlQuery query(database());
     query.exec(QStringLiteral("SELECT * FROM metadata WHERE id = '%1';").arg(_id));
 
     while(query.next())
@@ -70,35 +291,111 @@ bool Db::readMetadata(Video &video) const
 
 void Db::writeMetadata(const Video &video) const
 {
-    QSqlQuery query(_db);
-    query.exec(QStringLiteral("INSERT OR REPLACE INTO metadata VALUES('%1',%2,%3,%4,%5,'%6','%7',%8,%9);")
+    QSqlQuery query(database());
+    query.exec(QStringLiteral("INSERT OR REPLACE INTO metadata (id, size, duration, bitrate, framerate, codec, audio, "
+                              "width, height, cached) VALUES('%1',%2,%3,%4,%5,'%6','%7',%8,%9,%10);")
                .arg(_id).arg(video.size).arg(video.duration).arg(video.bitrate).arg(video.framerate)
-               .arg(video.codec).arg(video.audio).arg(video.width).arg(video.height));
+               .arg(video.codec).arg(video.audio).arg(video.width).arg(video.height)
+               .arg(QDateTime::currentMSecsSinceEpoch()));
 }
 
 QByteArray Db::readCapture(const int &percent) const
 {
-    QSqlQuery query(_db);
-    query.exec(QStringLiteral("SELECT at%1 FROM capture WHERE id = '%2';").arg(percent).arg(_id));
+    const auto preloaded = _preloaded.constFind(_id);
+    if(preloaded != _preloaded.cend())
+        for(const auto &capture : preloaded->captures)
+            if(capture.percent == percent)
+                return Pack::read(_cacheFile, capture.pack, capture.start, capture.length);
 
+    QSqlQuery query(database());
+    query.exec(QStringLiteral("SELECT pack, start, length FROM capturePack WHERE id = '%1' AND percent = %2;")
+               .arg(_id).arg(percent));
+    while(query.next())
+        return Pack::read(_cacheFile, query.value(0).toInt(), query.value(1).toLongLong(),
+                          query.value(2).toInt());
+
+    if(!_legacyCaptures)
+        return nullptr;
+    query.exec(QStringLiteral("SELECT at%1 FROM capture WHERE id = '%2';").arg(percent).arg(_id));
     while(query.next())
         return query.value(0).toByteArray();
     return nullptr;
 }
 
-void Db::writeCapture(const int &percent, const QByteArray &image) const
+void Db::writeCapture(const int &percent, const QByteArray &image, const int64_t &position) const
 {
-    QSqlQuery query(_db);
-    query.exec(QStringLiteral("INSERT OR IGNORE INTO capture (id) VALUES('%1');").arg(_id));
+    int pack;
+    qint64 start;
+    if(!Pack::append(_cacheFile, image, pack, start))
+        return;
+
+    QSqlQuery query(database());                        //image replaced is left in its pack until compacted
+    query.exec(QStringLiteral("INSERT OR REPLACE INTO capturePack VALUES('%1', %2, %3, %4, %5);")
+               .arg(_id).arg(percent).arg(pack).arg(start).arg(image.size()));
+    query.exec(QStringLiteral("INSERT OR REPLACE INTO capturePosition VALUES('%1', %2, %3);")
+               .arg(_id).arg(percent).arg(position));
+}
 
-    query.prepare(QStringLiteral("UPDATE capture SET at%1 = :image WHERE id = '%2';").arg(percent).arg(_id));
-    query.bindValue(QStringLiteral(":image"), image);
+bool Db::readFrameHash(const int &percent, const int &algorithm, Fingerprint &hash) const
+{
+    const auto preloaded = _preloaded.constFind(_id);
+    if(algorithm == _preloadedAlgorithm && preloaded != _preloaded.cend())
+    {
+        const QByteArray &frameHashes = preloaded->frameHashes;
+        const int entry = 1 + static_cast<int>(sizeof(Fingerprint));
+        for(int i=0; i+entry<=frameHashes.size(); i+=entry)
+            if(frameHashes[i] == static_cast<char>(percent))
+            {
+                memcpy(&hash, frameHashes.constData() + i + 1, sizeof(Fingerprint));
+                return true;
+            }
+    }
+
+    QSqlQuery query(database());
+    query.exec(QStringLiteral("SELECT hash FROM frameHash WHERE id = '%1' AND percent = %2 AND algorithm = %3;")
+               .arg(_id).arg(percent).arg(algorithm));
+
+    while(query.next())
+    {
+        const QByteArray stored = query.value(0).toByteArray();
+        if(stored.size() != sizeof(Fingerprint))
+            return false;
+        memcpy(&hash, stored.constData(), sizeof(Fingerprint));
+        return true;
+    }
+    return false;
+}
+
+void Db::writeFrameHash(const int &percent, const int &algorithm, const Fingerprint &hash) const
+{
+    QSqlQuery query(database());
+    query.prepare(QStringLiteral("INSERT OR REPLACE INTO frameHash VALUES('%1', %2, %3, :hash);")
+                  .arg(_id).arg(percent).arg(algorithm));
+    query.bindValue(QStringLiteral(":hash"), QByteArray(reinterpret_cast<const char *>(&hash), sizeof(Fingerprint)));
+    query.exec();
+}
+
+QByteArray Db::readAudio(const int &percent) const
+{
+    QSqlQuery query(database());
+    query.exec(QStringLiteral("SELECT prints FROM audio WHERE id = '%1' AND percent = %2;").arg(_id).arg(percent));
+
+    while(query.next())
+        return query.value(0).toByteArray();
+    return nullptr;
+}
+
+void Db::writeAudio(const int &percent, const QByteArray &prints) const
+{
+    QSqlQuery query(database());
+    query.prepare(QStringLiteral("INSERT OR REPLACE INTO audio VALUES('%1', %2, :prints);").arg(_id).arg(percent));
+    query.bindValue(QStringLiteral(":prints"), prints);
     query.exec();
 }
 
 bool Db::removeVideo(const QString &id) const
 {
-    QSqlQuery query(_db);
+    QSqlQuery query(database());
 
     bool idCached = false;
     query.exec(QStringLiteral("SELECT id FROM metadata WHERE id = '%1';").arg(id));
@@ -108,10 +405,37 @@ bool Db::removeVideo(const QString &id) const
         return false;
 
     query.exec(QStringLiteral("DELETE FROM metadata WHERE id = '%1';").arg(id));
-    query.exec(QStringLiteral("DELETE FROM capture WHERE id = '%1';").arg(id));
+    query.exec(QStringLiteral("DELETE FROM capturePack WHERE id = '%1';").arg(id));
+    if(_legacyCaptures)
+        query.exec(QStringLiteral("DELETE FROM capture WHERE id = '%1';").arg(id));
+    query.exec(QStringLiteral("DELETE FROM capturePosition WHERE id = '%1';").arg(id));
+    query.exec(QStringLiteral("DELETE FROM frameHash WHERE id = '%1';").arg(id));
+    query.exec(QStringLiteral("DELETE FROM audio WHERE id = '%1';").arg(id));
 
     query.exec(QStringLiteral("SELECT id FROM metadata WHERE id = '%1';").arg(id));
     while(query.next())
         return false;
     return true;
 }
+
+bool Db::removeVideos(const QStringList &ids)
+{
+    if(ids.isEmpty())
+        return true;
+
+    const Db cache(cacheFile());
+    QSqlQuery query(cache.database());
+    cache.database().transaction();
+    for(int first=0; first<ids.count(); first+=_removeBatch)
+    {
+        const QString batch = QStringLiteral("'%1'").arg(ids.mid(first, _removeBatch).join(QStringLiteral("','")));
+        query.exec(QStringLiteral("DELETE FROM metadata WHERE id IN (%1);").arg(batch));
+        query.exec(QStringLiteral("DELETE FROM capturePack WHERE id IN (%1);").arg(batch));
+        query.exec(QStringLiteral("DELETE FROM capturePosition WHERE id IN (%1);").arg(batch));
+        query.exec(QStringLiteral("DELETE FROM frameHash WHERE id IN (%1);").arg(batch));
+        query.exec(QStringLiteral("DELETE FROM audio WHERE id IN (%1);").arg(batch));
+        if(cache._legacyCaptures)
+            query.exec(QStringLiteral("DELETE FROM capture WHERE id IN (%1);").arg(batch));
+    }
+    return cache.database().commit();
+}
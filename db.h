@@ -3,27 +3,85 @@
 
 #include <QSqlDatabase>
 #include <QDateTime>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
 
 class Video;
+struct Fingerprint;
 
 class Db
 {
 
 public:
     explicit Db(const QString &filename);
-    ~Db() { _db.close(); _db = QSqlDatabase(); _db.removeDatabase(_connection); }
+    ~Db();
 
 private:
-    QSqlDatabase _db;
+    struct CaptureLocation              //row of capturePack table
+    {
+        int percent;
+        int pack;
+        qint64 start;
+        int length;
+    };
+
+    struct Metadata                     //row of metadata table, with frame fingerprints of one hash algorithm
+    {
+        int64_t size;
+        int64_t duration;
+        int bitrate;
+        double framerate;
+        QString codec;
+        QString audio;
+        short width;
+        short height;
+        QByteArray frameHashes;         //percent (one byte) and fingerprint of each cached frame
+        QVector<CaptureLocation> captures;
+    };
+
+    static QString _cacheFilename;      //cache.db next to executable unless set
+    static QHash<QString, bool> _prepared;                  //cache files whose tables exist, true if legacy captures
+    static QHash<QString, Metadata> _preloaded;             //not changed while videos are processed, read without lock
+    static int _preloadedAlgorithm;
+    static constexpr int _removeBatch = 500;                //ids in one DELETE statement
+
+    static QString idOf(const QString &name, const QDateTime &modified);
+
+    mutable QSqlDatabase _db;           //opened by database() when first needed, not for videos found preloaded
     QString _connection;
+    QString _cacheFile;
     QString _id;
     QDateTime _modified;
+    mutable bool _legacyCaptures = false;   //capture table of older versions with images inside, read until compacted
+
+    QSqlDatabase &database() const;
 
 public:
+    //use another cache file, for all Db instances created after this
+    static void setCacheFile(const QString &filename) { _cacheFilename = filename; }
+    static QString cacheFile();
+
+    //copy entries of another cache file into this one. metadata cached later wins if both have the same video,
+    //screen captures and audio missing from this one are added
+    static bool mergeCache(const QString &from);
+
+    //rewrite pack files with only screen captures still in use and move images of older cache versions into packs.
+    //no other process may use cache meanwhile
+    static bool compactCache();
+
+    //read whole metadata table, frame fingerprints of hash algorithm and where screen captures are at once. Db
+    //instances look videos up there and open cache only if missing. must not be called while videos are processed
+    static void preload(const int &algorithm);
+    static void releasePreload() { _preloaded = QHash<QString, Metadata>(); _preloadedAlgorithm = -1; }
+
     //return md5 hash of parameter's file, or (as convinience) md5 hash of the file given to constructor
     QString uniqueId(const QString &filename=QStringLiteral("")) const;
 
-    //constructor creates a database file if there is none already
+    //same id as uniqueId() of a Db made for this file, without opening cache
+    static QString videoId(const QString &filename);
+
+    //first query creates a database file if there is none already
     void createTables() const;
 
     //return true and updates member variables if the video metadata was cached
@@ -32,14 +90,30 @@ public:
     //save video properties in cache
     void writeMetadata(const Video &video) const;
 
-    //returns screen capture if it was cached, else return null ptr
+    //returns screen capture if it was cached, else return null ptr. not copied, valid while program runs
     QByteArray readCapture(const int &percent) const;
 
-    //save image in cache
-    void writeCapture(const int &percent, const QByteArray &image) const;
+    //append image to pack file and save where it is, with position (ms) where it was actually taken if video had to
+    //be searched backwards
+    void writeCapture(const int &percent, const QByteArray &image, const int64_t &position) const;
+
+    //returns true and sets hash if fingerprint of screen capture alone was cached for this hash algorithm
+    bool readFrameHash(const int &percent, const int &algorithm, Fingerprint &hash) const;
+
+    //save fingerprint of screen capture alone
+    void writeFrameHash(const int &percent, const int &algorithm, const Fingerprint &hash) const;
+
+    //returns audio sub-fingerprints if they were cached, else return null ptr
+    QByteArray readAudio(const int &percent) const;
+
+    //save audio sub-fingerprints in cache
+    void writeAudio(const int &percent, const QByteArray &prints) const;
 
     //returns false if id not cached or could not be removed
     bool removeVideo(const QString &id) const;
+
+    //remove many videos in one transaction, returns false if it failed
+    static bool removeVideos(const QStringList &ids);
 };
 
 #endif // DB_H
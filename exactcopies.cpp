@@ -0,0 +1,107 @@
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QSet>
+#include "exactcopies.h"
+#include "video.h"
+
+constexpr int ExactCopies::_chunkSize;
+constexpr int ExactCopies::_chunks;
+constexpr int ExactCopies::_blockSize;
+
+QStringList ExactCopies::find(const QStringList &filenames)
+{
+    _copies.clear();
+
+    QHash<qint64, QStringList> bySize;
+    for(const auto &filename : filenames)
+        bySize[QFileInfo(filename).size()] << filename;
+
+    QSet<QString> leftOut;
+    for(auto sameSize=bySize.cbegin(); sameSize!=bySize.cend(); sameSize++)
+    {
+        if(sameSize.value().count() < 2 || sameSize.key() == 0)
+            continue;                           //unique size cannot have a copy, empty files are rejected anyway
+
+        QHash<QByteArray, QStringList> byChunks;
+        for(const auto &filename : sameSize.value())
+        {
+            if(Video::aborted())
+                return filenames;
+            const QByteArray hash = chunkHash(filename, sameSize.key());
+            if(!hash.isEmpty())
+                byChunks[hash] << filename;
+        }
+
+        for(const auto &sameChunks : byChunks)
+        {
+            if(sameChunks.count() < 2)
+                continue;
+            QHash<QByteArray, QStringList> byContent;     //chunks matched, whole file decides
+            for(const auto &filename : sameChunks)
+            {
+                if(Video::aborted())
+                    return filenames;
+                const QByteArray hash = fullHash(filename);
+                if(!hash.isEmpty())
+                    byContent[hash] << filename;
+            }
+            for(const auto &identical : byContent)
+                if(identical.count() > 1)
+                {
+                    _copies.insert(identical.first(), identical.mid(1));
+                    for(int copy=1; copy<identical.count(); copy++)
+                        leftOut << identical[copy];
+                }
+        }
+    }
+
+    QStringList toProcess;
+    for(const auto &filename : filenames)
+        if(!leftOut.contains(filename))
+            toProcess << filename;
+    return toProcess;
+}
+
+int ExactCopies::count() const
+{
+    int copies = 0;
+    for(const auto &identical : _copies)
+        copies += identical.count();
+    return copies;
+}
+
+QByteArray ExactCopies::chunkHash(const QString &filename, const qint64 &size)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    for(int chunk=0; chunk<_chunks; chunk++)    //small files are read whole
+    {
+        const qint64 offset = qMax(static_cast<qint64>(0), (size - _chunkSize) * chunk / (_chunks - 1));
+        if(!file.seek(offset))
+            return QByteArray();
+        hash.addData(file.read(_chunkSize));
+    }
+    return hash.result();
+}
+
+QByteArray ExactCopies::fullHash(const QString &filename)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    while(!file.atEnd())                        //large files, stop can end it between blocks
+    {
+        if(Video::aborted())
+            return QByteArray();
+        const QByteArray block = file.read(_blockSize);
+        if(block.isEmpty())
+            return QByteArray();
+        hash.addData(block);
+    }
+    return hash.result();
+}
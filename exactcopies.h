@@ -0,0 +1,38 @@
+#ifndef EXACTCOPIES_H
+#define EXACTCOPIES_H
+
+#include <QStringList>
+#include <QHash>
+
+//byte-identical files are found before any video is decoded. files are grouped by size, those sharing a size are
+//hashed from a few chunks, and only those whose chunks also match are hashed whole. the first file of each group is
+//processed, the others get its fingerprints without running ffmpeg
+
+class ExactCopies
+{
+
+public:
+    ExactCopies() {}
+
+private:
+    QHash<QString, QStringList> _copies;        //copies of each file that is processed
+
+    static constexpr int _chunkSize = 65536;    //bytes read from beginning, middle and end
+    static constexpr int _chunks    = 3;
+    static constexpr int _blockSize = 1048576;  //bytes read at a time when hashing whole file
+
+    static QByteArray chunkHash(const QString &filename, const qint64 &size);
+    static QByteArray fullHash(const QString &filename);
+
+public:
+    //group identical files. returns files to process: all but the copies, in original order. stops if aborted
+    QStringList find(const QStringList &filenames);
+
+    //identical files of each file returned by find() that has any
+    const QHash<QString, QStringList> &copies() const { return _copies; }
+
+    //number of files left out as copies
+    int count() const;
+};
+
+#endif // EXACTCOPIES_H
@@ -0,0 +1,72 @@
+#include <QFile>
+#include <QStringList>
+#include <QThread>
+#include "governor.h"
+
+int Governor::_budget = 100;
+std::atomic<int> Governor::_ffmpegThreads(1);
+constexpr int Governor::_initialWorkers;
+
+Governor::Governor()
+{
+    _cores = qMax(1, QThread::idealThreadCount() * _budget / 100);
+    _maxWorkers = _cores;
+    setWorkers(qMin(_cores, _initialWorkers));
+    sample(_busy, _total, _switches);
+    _sinceSample.start();
+}
+
+void Governor::setWorkers(const int &workers)
+{
+    _workers = qBound(1, workers, _maxWorkers);
+    _ffmpegThreads = qMax(1, _cores / _workers);        //cores are shared out among running ffmpeg processes
+}
+
+bool Governor::sample(uint64_t &busy, uint64_t &total, uint64_t &switches) const
+{
+    QFile stat(QStringLiteral("/proc/stat"));           //Linux only, elsewhere workers stay as they started
+    if(!stat.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    bool found = false;
+    for(QByteArray line=stat.readLine(); !line.isEmpty(); line=stat.readLine())
+    {
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        if(fields.value(0) == "cpu")                    //user nice system idle iowait irq softirq steal
+        {
+            total = 0;
+            for(int field=1; field<fields.count() && field<=8; field++)
+                total += fields[field].toULongLong();
+            busy = total - fields.value(4).toULongLong() - fields.value(5).toULongLong();
+            found = true;
+        }
+        else if(fields.value(0) == "ctxt")
+            switches = fields.value(1).toULongLong();
+    }
+    return found;
+}
+
+bool Governor::adapt()
+{
+    if(_sinceSample.elapsed() < _sampleInterval)
+        return false;
+
+    uint64_t busy = 0, total = 0, switches = 0;
+    const qint64 elapsed = qMax(_sinceSample.restart(), static_cast<qint64>(1));
+    if(!sample(busy, total, switches) || total <= _total)
+        return false;
+
+    const uint64_t usage = 100 * (busy - _busy) / (total - _total);
+    const uint64_t switchesPerCore = (switches - _switches) * 1000 / static_cast<uint64_t>(elapsed) /
+                                     static_cast<uint64_t>(_cores);
+    _busy = busy;
+    _total = total;
+    _switches = switches;
+
+    const int workers = _workers;
+    if(switchesPerCore > _maxSwitchesCore)              //threads fight for cores
+        setWorkers(_workers - 1);
+    else if(usage < _idlePercent)                       //waiting for disk or ffmpeg startup, more can run
+        setWorkers(_workers + 1);
+    return workers != _workers;
+}
@@ -0,0 +1,51 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <QElapsedTimer>
+#include <atomic>
+
+//decides how many videos are processed at once and how many threads each ffmpeg decodes with. starts from number of
+//cores and CPU budget, then adds or removes a worker by CPU use and context switches read from /proc/stat, if present.
+//ffmpeg starts a thread per core by default, so many workers would otherwise mean a thousand runnable threads
+
+class Governor
+{
+
+public:
+    Governor();
+
+private:
+    static int _budget;                                 //percent of cores to use
+    static std::atomic<int> _ffmpegThreads;
+
+    int _cores;                                         //cores within budget
+    int _workers;
+    int _maxWorkers;
+    QElapsedTimer _sinceSample;
+    uint64_t _busy = 0;                                 //counters of last /proc/stat sample
+    uint64_t _total = 0;
+    uint64_t _switches = 0;
+
+    static constexpr int _initialWorkers   = 8;         //more than this rarely helps, disk is shared
+    static constexpr int _sampleInterval   = 2000;      //ms between adjustments
+    static constexpr int _idlePercent      = 80;        //CPU use below this: add a worker
+    static constexpr int _maxSwitchesCore  = 20000;     //context switches per core and second above this: remove one
+
+    bool sample(uint64_t &busy, uint64_t &total, uint64_t &switches) const;
+    void setWorkers(const int &workers);
+
+public:
+    //percent of cores used for processing videos, for all governors created after this
+    static void setBudget(const int &percent) { _budget = qBound(1, percent, 100); }
+
+    //threads each ffmpeg process may use, for -threads
+    static int ffmpegThreads() { return _ffmpegThreads; }
+
+    //videos to process at once
+    int workers() const { return _workers; }
+
+    //measure CPU use since last call and adjust workers, returns true if changed. cheap to call often
+    bool adapt();
+};
+
+#endif // GOVERNOR_H
@@ -0,0 +1,186 @@
+#include <QMessageBox>
+#include <QFileDialog>
+#include <QPushButton>
+#include <QtConcurrent/QtConcurrent>
+#include "groupview.h"
+#include "comparison.h"
+#include "resolver.h"
+#include "ui_groupview.h"
+
+GroupView::GroupView(Session &sessionParam, const QVector< QVector<int> > &groupsParam,
+                     const QVector<Match> &matchesParam, const Prefs &prefsParam) :
+    QDialog(prefsParam._mainwPtr, Qt::Window), _session(sessionParam), _groups(groupsParam), _matches(matchesParam),
+    _prefs(prefsParam)
+{
+    ui = new Ui::GroupView;
+    ui->setupUi(this);
+
+    connect(this, SIGNAL(sendStatusMessage(const QString &)), _prefs._mainwPtr, SLOT(addStatusMessage(const QString &)));
+
+    showGroup(0);
+}
+
+GroupView::~GroupView()
+{
+    delete ui;
+}
+
+void GroupView::showGroup(const int &group)
+{
+    ui->groupMembers->clear();
+    if(_groups.isEmpty())
+    {
+        ui->groupInfo->setText(QStringLiteral("No matching videos left"));
+        ui->keepSelected->setDisabled(true);
+        ui->resolveAll->setDisabled(true);
+        return;
+    }
+
+    _group = group;
+    int64_t groupSize = 0;
+    int64_t largestSize = 0;
+    const int keep = Resolver(_session).keeper(_groups[_group]);
+    int kept = 0;
+    for(int i=0; i<_groups[_group].count(); i++)
+    {
+        const int video = _groups[_group][i];
+        QImage image;
+        image.loadFromData(_session.thumbnail(video), "JPG");
+
+        const QString filename = _session.filename(video);
+        const QString text = QStringLiteral("%1\n%2  %3  %4x%5").arg(QFileInfo(filename).fileName(),
+                             Comparison::readableFileSize(_session.size(video)),
+                             Comparison::readableDuration(_session.duration(video)))
+                             .arg(_session.width(video)).arg(_session.height(video));
+        auto *item = new QListWidgetItem(QIcon(QPixmap::fromImage(image)), text, ui->groupMembers);
+        item->setToolTip(QDir::toNativeSeparators(filename));
+
+        groupSize += _session.size(video);
+        largestSize = qMax(largestSize, _session.size(video));
+        if(video == keep)
+            kept = i;
+    }
+    ui->groupMembers->setCurrentRow(kept);          //one "Resolve all groups" would keep, if it still exists
+    ui->keepSelected->setDisabled(false);
+    ui->resolveAll->setDisabled(false);
+
+    ui->groupInfo->setText(QStringLiteral("Group %1/%2: %3 videos, %4 (%5 can be freed)")
+                           .arg(_group + 1).arg(_groups.count()).arg(_groups[_group].count())
+                           .arg(Comparison::readableFileSize(groupSize), Comparison::readableFileSize(groupSize - largestSize)));
+}
+
+void GroupView::on_keepSelected_clicked()
+{
+    const int keep = ui->groupMembers->currentRow();
+    if(keep < 0 || _groups.isEmpty())
+        return;
+
+    const QString keepFilename = _session.filename(_groups[_group][keep]);
+    const QString question = QStringLiteral("Are you sure you want to delete %1 file(s) and keep only this one?\n\n%2")
+                             .arg(_groups[_group].count() - 1).arg(QFileInfo(keepFilename).fileName());
+    if(QMessageBox::question(this, QStringLiteral("Delete files"), question,
+                             QMessageBox::Yes, QMessageBox::No) != QMessageBox::Yes)
+        return;
+
+    int videosDeleted = 0;
+    int64_t spaceSaved = 0;
+    for(int i=0; i<_groups[_group].count(); i++)
+    {
+        if(i == keep)
+            continue;
+        const QString filename = _session.filename(_groups[_group][i]);
+        if(!QFileInfo::exists(filename))            //video was already manually deleted
+            continue;
+        const Db cache(filename);                   //generate unique id before file has been deleted
+        const QString id = cache.uniqueId();
+        if(!QFile::remove(filename))
+            emit sendStatusMessage(QStringLiteral("Could not delete %1").arg(QDir::toNativeSeparators(filename)));
+        else
+        {
+            videosDeleted++;
+            spaceSaved += _session.size(_groups[_group][i]);
+            cache.removeVideo(id);
+            emit sendStatusMessage(QStringLiteral("Deleted %1").arg(QDir::toNativeSeparators(filename)));
+        }
+    }
+    if(videosDeleted)
+        emit sendStatusMessage(QStringLiteral("\n%1 file(s) deleted, %2 freed")
+                               .arg(videosDeleted).arg(Comparison::readableFileSize(spaceSaved)));
+
+    _groups.remove(_group);
+    showGroup(qMin(_group, _groups.count() - 1));
+}
+
+void GroupView::on_resolveAll_clicked()
+{
+    const Resolver resolver(_session);
+    const QVector<Resolver::Action> actions = resolver.plan(_groups, _matches);
+    if(actions.isEmpty())
+        return;
+    int indirect = 0;
+    for(const auto &action : actions)
+        indirect += !action.direct;
+
+    QMessageBox dryRun(this);                       //nothing is touched before user has seen the whole plan
+    dryRun.setWindowTitle(QStringLiteral("Resolve all groups"));
+    dryRun.setIcon(QMessageBox::Question);
+    dryRun.setText(QStringLiteral("Keep one video of each of %1 group(s) and remove %2 file(s), freeing %3?\n\n"
+                                  "Kept by: %4%5")
+                   .arg(_groups.count()).arg(actions.count())
+                   .arg(Comparison::readableFileSize(resolver.reclaimed(actions)), resolver.rules(),
+                        indirect? QStringLiteral("\n\n%1 file(s) do not match the video kept, only other videos of "
+                                                 "its group. They are marked in details.").arg(indirect) :
+                                  QStringLiteral("")));
+    dryRun.setDetailedText(resolver.report(actions));
+    QPushButton *deleteButton = dryRun.addButton(QStringLiteral("Delete"), QMessageBox::DestructiveRole);
+    QPushButton *moveButton = dryRun.addButton(QStringLiteral("Move to folder..."), QMessageBox::ActionRole);
+    dryRun.addButton(QMessageBox::Cancel);
+    dryRun.setDefaultButton(QMessageBox::Cancel);
+    dryRun.exec();
+
+    QString moveTo;
+    if(dryRun.clickedButton() == moveButton)
+    {
+        moveTo = QFileDialog::getExistingDirectory(this, QStringLiteral("Move removed videos to"));
+        if(moveTo.isEmpty())
+            return;
+    }
+    else if(dryRun.clickedButton() != deleteButton)
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QFutureWatcher< QVector<int> > resolving;
+    QEventLoop waitUntilResolved;
+    connect(&resolving, &QFutureWatcher< QVector<int> >::finished, &waitUntilResolved, &QEventLoop::quit);
+    resolving.setFuture(QtConcurrent::run([&resolver, &actions, &moveTo]() { return resolver.execute(actions, moveTo); }));
+    waitUntilResolved.exec();
+    QApplication::restoreOverrideCursor();
+
+    const QVector<int> removed = resolving.result();
+    int64_t spaceSaved = 0;
+    QSet<int> failed;
+    for(const auto &action : actions)
+        failed << action.video;
+    for(const auto &video : removed)
+    {
+        spaceSaved += _session.size(video);
+        failed.remove(video);
+    }
+    emit sendStatusMessage(QStringLiteral("\n%1 of %2 file(s) %3, %4 %5")
+                           .arg(removed.count()).arg(actions.count())
+                           .arg(moveTo.isEmpty()? QStringLiteral("deleted") : QStringLiteral("moved to %1")
+                                                  .arg(QDir::toNativeSeparators(moveTo)),
+                                Comparison::readableFileSize(spaceSaved),
+                                moveTo.isEmpty()? QStringLiteral("freed") : QStringLiteral("moved")));
+
+    QVector< QVector<int> > unresolved;             //groups where a file could not be removed stay
+    for(const auto &group : _groups)
+        for(const auto &video : group)
+            if(failed.contains(video))
+            {
+                unresolved << group;
+                break;
+            }
+    _groups = unresolved;
+    showGroup(0);
+}
@@ -0,0 +1,40 @@
+#ifndef GROUPVIEW_H
+#define GROUPVIEW_H
+
+#include <QDialog>
+#include "video.h"
+#include "session.h"
+#include "matchfile.h"
+
+namespace Ui { class GroupView; }
+
+class GroupView : public QDialog
+{
+    Q_OBJECT
+
+public:
+    GroupView(Session &sessionParam, const QVector< QVector<int> > &groupsParam, const QVector<Match> &matchesParam,
+              const Prefs &prefsParam);
+    ~GroupView();
+
+private:
+    Ui::GroupView *ui;
+
+    Session &_session;
+    QVector< QVector<int> > _groups;            //indexes of _session, each group has two or more matching videos
+    QVector<Match> _matches;                    //pairs groups were made of
+    Prefs _prefs;
+    int _group = 0;
+
+private slots:
+    void on_prevGroup_clicked() { if(_group > 0) showGroup(_group - 1); }
+    void on_nextGroup_clicked() { if(_group < _groups.count() - 1) showGroup(_group + 1); }
+    void on_keepSelected_clicked();
+    void on_resolveAll_clicked();
+    void showGroup(const int &group);
+
+signals:
+    void sendStatusMessage(const QString &message) const;
+};
+
+#endif // GROUPVIEW_H
@@ -0,0 +1,173 @@
+#ifndef HASHER_H
+#define HASHER_H
+
+#include <QStringList>
+#include <algorithm>
+#include <opencv2/imgproc/imgproc.hpp>
+
+//every hasher below is a class with only static members, so the one in use is chosen at compile time:
+//  bits                         number of bits in hash (multiple of 64)
+//  compute(image)               hash of an 8 bit, 3 channel image of any size
+//  distance(hash1, hash2)       number of differing bits
+
+struct Fingerprint
+{
+    static constexpr int maxWords = 4;                  //large enough for widest hasher (256 bits)
+    uint64_t word[maxWords] = { 0, 0, 0, 0 };
+
+    bool isNull() const { return (word[0] | word[1] | word[2] | word[3]) == 0; }
+    void setBit(const int &bit) { word[bit / 64] |= 1ULL << (bit % 64); }
+};
+
+inline int countBits(uint64_t value)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(value);
+#else
+    int bits = 0;
+    for(; value; bits++)
+        value &= value - 1;
+    return bits;
+#endif
+}
+
+template<int Words> inline int hammingDistance(const Fingerprint &hash1, const Fingerprint &hash2)
+{
+    int distance = 0;
+    for(int i=0; i<Words; i++)                          //XOR to value (only ones for differing bits)
+        distance += countBits(hash1.word[i] ^ hash2.word[i]);
+    return distance;
+}
+
+inline cv::Mat grayResized(const cv::Mat &input, const int &width, const int &height)
+{
+    cv::Mat resizeImg, grayImg;
+    cv::resize(input, resizeImg, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    cv::cvtColor(resizeImg, grayImg, cv::COLOR_BGR2GRAY);
+    return grayImg;
+}
+
+template<int Block> class DctHash               //pHash: DCT of image, only upper left Block*Block transforms used
+{
+public:
+    static constexpr int bits = Block * Block;
+    static constexpr int imageSize = Block * 4; //8x8 transforms from 32x32 image, 16x16 from 64x64
+
+    static Fingerprint compute(const cv::Mat &input)
+    {
+        cv::Mat grayFImg, dctImg, topLeftDCT;
+        grayResized(input, imageSize, imageSize).convertTo(grayFImg, CV_32F);
+        cv::dct(grayFImg, dctImg);                          //compute DCT (discrete cosine transform)
+        dctImg(cv::Rect(0, 0, Block, Block)).copyTo(topLeftDCT);    //most significant transforms only
+
+        const float firstElement = *reinterpret_cast<float*>(topLeftDCT.data);  //compute avg but skip first element
+        const float average = (static_cast<float>(cv::sum(topLeftDCT)[0]) - firstElement) / (bits - 1);
+
+        Fingerprint hash;
+        const float* transform = reinterpret_cast<float*>(topLeftDCT.data);
+        for(int i=0; i<bits; i++)
+            if(transform[i] > average)
+                hash.setBit(i);                             //larger than avg = 1, smaller than avg = 0
+        return hash;
+    }
+    static int distance(const Fingerprint &hash1, const Fingerprint &hash2)
+        { return hammingDistance<bits / 64>(hash1, hash2); }
+};
+
+class DifferenceHash                            //dHash: is pixel brighter than its right neighbour
+{
+public:
+    static constexpr int bits = 64;
+
+    static Fingerprint compute(const cv::Mat &input)
+    {
+        const cv::Mat grayImg = grayResized(input, 9, 8);
+        Fingerprint hash;
+        for(int row=0, i=0; row<8; row++)
+        {
+            const uchar* pixel = grayImg.ptr<uchar>(row);
+            for(int col=0; col<8; col++, i++)
+                if(pixel[col] > pixel[col+1])
+                    hash.setBit(i);
+        }
+        return hash;
+    }
+    static int distance(const Fingerprint &hash1, const Fingerprint &hash2)
+        { return hammingDistance<1>(hash1, hash2); }
+};
+
+class AverageHash                               //aHash: is pixel brighter than average of 8x8 image
+{
+public:
+    static constexpr int bits = 64;
+
+    static Fingerprint compute(const cv::Mat &input)
+    {
+        const cv::Mat grayImg = grayResized(input, 8, 8);
+        const double average = cv::mean(grayImg)[0];
+        Fingerprint hash;
+        const uchar* pixel = grayImg.data;
+        for(int i=0; i<bits; i++)
+            if(pixel[i] > average)
+                hash.setBit(i);
+        return hash;
+    }
+    static int distance(const Fingerprint &hash1, const Fingerprint &hash2)
+        { return hammingDistance<1>(hash1, hash2); }
+};
+
+class WaveletHash                               //wHash: 3 level Haar transform of 64x64 image, 8x8 lowpass band
+{                                               //coefficients compared with their median
+public:
+    static constexpr int bits = 64;
+
+    static Fingerprint compute(const cv::Mat &input)
+    {
+        cv::Mat band;
+        grayResized(input, 64, 64).convertTo(band, CV_32F, 1.0 / 255);
+        for(int size=32; size>=8; size/=2)
+        {
+            cv::Mat lowpass(size, size, CV_32F);
+            for(int row=0; row<size; row++)
+                for(int col=0; col<size; col++)
+                    lowpass.at<float>(row, col) = (band.at<float>(2*row, 2*col)   + band.at<float>(2*row, 2*col+1) +
+                                                   band.at<float>(2*row+1, 2*col) + band.at<float>(2*row+1, 2*col+1)) / 2;
+            band = lowpass;
+        }
+
+        std::vector<float> sorted(band.begin<float>(), band.end<float>());
+        std::nth_element(sorted.begin(), sorted.begin() + bits / 2, sorted.end());
+        const float median = sorted[bits / 2];
+
+        Fingerprint hash;
+        const float* coefficient = reinterpret_cast<float*>(band.data);
+        for(int i=0; i<bits; i++)
+            if(coefficient[i] > median)
+                hash.setBit(i);
+        return hash;
+    }
+    static int distance(const Fingerprint &hash1, const Fingerprint &hash2)
+        { return hammingDistance<1>(hash1, hash2); }
+};
+
+typedef DctHash<8>  PerceptualHash;
+typedef DctHash<16> WidePerceptualHash;
+
+//similarity is always scaled to 64 bits, so that comparison threshold works the same for every hasher
+template<class Hasher> inline int similarityOf64(const Fingerprint &hash1, const Fingerprint &hash2)
+{
+    return 64 - Hasher::distance(hash1, hash2) * 64 / Hasher::bits;
+}
+
+class HashAlgorithm
+{
+public:
+    static int count() { return names().count(); }
+    static QString name(const int &algorithm) { return names().value(algorithm); }
+
+private:
+    static QStringList names() { return { QStringLiteral("pHash"), QStringLiteral("dHash"), QStringLiteral("aHash"),
+                                          QStringLiteral("wHash"), QStringLiteral("pHash256") }; }
+};
+
+#endif // HASHER_H
@@ -1,17 +1,139 @@
 #include <QFileDialog>
 #include <QtConcurrent/QtConcurrent>
 #include <QScrollBar>
+#include <QCommandLineParser>
 #include "mainwindow.h"
 #include "comparison.h"
+#include "matchfile.h"
+#include "worker.h"
+#include "governor.h"
+#include "watcher.h"
+
+static bool withoutGui(int argc, char *argv[])
+{                                               //parser needs an application, so options are looked up by hand
+    for(int i=1; i<argc; i++)
+        for(const auto &option : { "--worker", "--merge-cache", "--compact-cache", "--watch" })
+        {
+            const size_t length = strlen(option);
+            if(strncmp(argv[i], option, length) == 0 && (argv[i][length] == '\0' || argv[i][length] == '='))
+                return true;
+        }
+    return false;
+}
 
 int main(int argc, char *argv[])
-{
-    QApplication a(argc, argv);
+{                                               //no display is needed for modes without window
+    QScopedPointer<QCoreApplication> a(withoutGui(argc, argv)? new QCoreApplication(argc, argv) :
+                                                               new QApplication(argc, argv));
+    QCoreApplication::setApplicationName(APP_NAME);
+    QCoreApplication::setApplicationVersion(APP_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Without options the GUI is opened"));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    const QCommandLineOption cacheOption(QStringLiteral("cache"),
+                QStringLiteral("Cache database to use instead of cache.db in program folder."), QStringLiteral("file"));
+    const QCommandLineOption workerOption(QStringLiteral("worker"),
+                QStringLiteral("Cache videos listed in <list> (one path per line) without GUI."), QStringLiteral("list"));
+    const QCommandLineOption shardOption(QStringLiteral("shard"),
+                QStringLiteral("Process only shard <i/n> of the list."), QStringLiteral("i/n"), QStringLiteral("1/1"));
+    const QCommandLineOption shardByOption(QStringLiteral("shard-by"),
+                QStringLiteral("Split list by continuous <range> or by <hash> of filename."),
+                QStringLiteral("range|hash"), QStringLiteral("range"));
+    const QCommandLineOption thumbnailsOption(QStringLiteral("thumbnails"),
+                QStringLiteral("Thumbnail mode 0-7, as in GUI list (7 = cut ends)."), QStringLiteral("mode"),
+                QString::number(cutEnds));
+    const QCommandLineOption audioOption(QStringLiteral("audio"), QStringLiteral("Also take audio fingerprints."));
+    const QCommandLineOption grayOption(QStringLiteral("gray"),
+                QStringLiteral("Take gray screen captures, faster. Only their fingerprints are cached, not the captures."));
+    const QCommandLineOption budgetOption(QStringLiteral("cpu-budget"),
+                QStringLiteral("Percent of cores used for processing videos."), QStringLiteral("percent"),
+                QStringLiteral("100"));
+    const QCommandLineOption watchOption(QStringLiteral("watch"),
+                QStringLiteral("Keep running without GUI, matching videos arriving in <folder> (repeatable)."),
+                QStringLiteral("folder"));
+    const QCommandLineOption matchesOption(QStringLiteral("matches"),
+                QStringLiteral("Append pairs found by --watch to <file> (.csv or JSON Lines)."), QStringLiteral("file"));
+    const QCommandLineOption mergeOption(QStringLiteral("merge-cache"),
+                QStringLiteral("Merge shard cache files given as arguments into cache."));
+    const QCommandLineOption logOption(QStringLiteral("log"),
+                QStringLiteral("Append status messages of GUI to <file>, also those dropped from status box."),
+                QStringLiteral("file"));
+    const QCommandLineOption compactOption(QStringLiteral("compact-cache"),
+                QStringLiteral("Remove unused screen captures from cache pack files, while Vidupe is not running."));
+    parser.addOptions( { cacheOption, workerOption, shardOption, shardByOption,
+                         thumbnailsOption, audioOption, grayOption, budgetOption, watchOption, matchesOption,
+                         mergeOption, compactOption, logOption } );
+    parser.addPositionalArgument(QStringLiteral("shards"), QStringLiteral("Shard cache files for --merge-cache."),
+                                 QStringLiteral("[shards...]"));
+    parser.process(*a);
+
+    if(parser.isSet(cacheOption))
+        Db::setCacheFile(parser.value(cacheOption));
+    Governor::setBudget(parser.value(budgetOption).toInt());
+
+    if(parser.isSet(mergeOption))
+    {
+        QTextStream out(stdout);
+        int failed = 0;
+        for(const auto &shard : parser.positionalArguments())
+        {
+            const bool merged = Db::mergeCache(shard);
+            out << QStringLiteral("%1 %2\n").arg(merged? QStringLiteral("Merged") : QStringLiteral("ERROR merging"),
+                                                 QDir::toNativeSeparators(shard));
+            failed += !merged;
+        }
+        return failed? 1 : 0;
+    }
+
+    if(parser.isSet(compactOption))
+    {
+        const bool compacted = Db::compactCache();
+        QTextStream(stdout) << QStringLiteral("%1 %2\n").arg(compacted? QStringLiteral("Compacted") :
+                                                                     QStringLiteral("ERROR compacting"),
+                                                          QDir::toNativeSeparators(Db::cacheFile()));
+        return compacted? 0 : 1;
+    }
+
+    const int thumbnails = parser.value(thumbnailsOption).toInt();
+    if(thumbnails < thumb1 || thumbnails > cutEnds)
+        parser.showHelp(1);
+    Prefs prefs;
+    prefs._thumbnails = thumbnails;
+    prefs._audioFingerprint = parser.isSet(audioOption);
+    prefs._grayCaptures = parser.isSet(grayOption);
+
+    if(parser.isSet(watchOption))
+    {
+        Watcher watcher(prefs, parser.values(watchOption), parser.value(matchesOption));
+        if(!watcher.start())
+            return 1;
+        return a->exec();
+    }
+
+    if(parser.isSet(workerOption))
+    {
+        const QStringList shard = parser.value(shardOption).split('/');
+        if(shard.count() != 2 || shard[1].toInt() < 1)
+            parser.showHelp(1);
+
+        Worker worker(prefs, parser.value(workerOption), shard[0].toInt(), shard[1].toInt(),
+                      parser.value(shardByOption) == QStringLiteral("hash"));
+        return worker.run();
+    }
+
     MainWindow w;
+    if(parser.isSet(logOption) && !w.setLogFile(parser.value(logOption)))
+        QTextStream(stderr) << QStringLiteral("Error: could not open log file %1\n")
+                               .arg(QDir::toNativeSeparators(parser.value(logOption)));
     w.show();
-    return a.exec();
+    return a->exec();
 }
 
+constexpr int MainWindow::_flushInterval;
+constexpr int MainWindow::_statusLines;
+
 MainWindow::MainWindow() : ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
@@ -21,6 +143,9 @@ MainWindow::MainWindow() : ui(new Ui::MainWindow)
     ui->statusBox->append(QStringLiteral("%1").arg(APP_COPYRIGHT).replace("\xEF\xBF\xBD ", QStringLiteral("© "))
                                                                  .replace("\xEF\xBF\xBD",  QStringLiteral("ä")));
     ui->statusBox->append(QStringLiteral("Licensed under GNU General Public License\n"));
+    ui->statusBox->document()->setMaximumBlockCount(_statusLines);
+    connect(&_flushTimer, &QTimer::timeout, this, &MainWindow::flushStatus);
+    _flushTimer.start(_flushInterval);
 
     deleteTemporaryFiles();
     loadExtensions();
@@ -34,14 +159,21 @@ MainWindow::MainWindow() : ui(new Ui::MainWindow)
     for(int i=0; i<thumb.countModes(); i++)
         ui->selectThumbnails->addItem(thumb.modeName(i));
     ui->selectThumbnails->setCurrentIndex(7);
+    for(int i=0; i<HashAlgorithm::count(); i++)
+        ui->selectHash->addItem(HashAlgorithm::name(i));
+    ui->selectHash->setCurrentIndex(_prefs._DCT64);
 
-    for(int i=0; i<=5; i++)
+    for(int i=0; i<=Candidates::_maxDurationModifier; i++)
     {
         ui->differentDurationCombo->addItem(QStringLiteral("%1").arg(i));
         ui->sameDurationCombo->addItem(QStringLiteral("%1").arg(i));
     }
     ui->differentDurationCombo->setCurrentIndex(4);
     ui->sameDurationCombo->setCurrentIndex(1);
+    ui->durationWindowCombo->addItems( { QStringLiteral("5%"), QStringLiteral("10%"), QStringLiteral("25%"),
+                                         QStringLiteral("50%"), QStringLiteral("10s"), QStringLiteral("60s"),
+                                         QStringLiteral("Any") } );
+    ui->durationWindowCombo->setCurrentIndex(1);
 
     ui->directoryBox->setFocus();
     ui->browseFolders->setIcon(ui->browseFolders->style()->standardIcon(QStyle::SP_DirOpenIcon));
@@ -120,6 +252,15 @@ void MainWindow::calculateThreshold(const int &value)
     ui->thresholdSlider->setToolTip(thresholdMessage);
 }
 
+void MainWindow::on_durationWindowCombo_activated(const int &index)
+{
+    const QString window = ui->durationWindowCombo->itemText(index);
+    const int value = window.left(window.length() - 1).toInt();
+    _prefs._durationWindowPercent = window.endsWith(QStringLiteral("%"))? value : 0;
+    _prefs._durationWindowSeconds = window.endsWith(QStringLiteral("s"))? value : 0;
+    ui->directoryBox->setFocus();
+}
+
 void MainWindow::on_browseFolders_clicked() const
 {
     const QString dir = QFileDialog::getExistingDirectory(nullptr, QByteArrayLiteral("Open folder"), QStringLiteral("/"),
@@ -130,17 +271,122 @@ void MainWindow::on_browseFolders_clicked() const
     ui->directoryBox->setFocus();
 }
 
+void MainWindow::on_actionExportMatches_triggered()
+{
+    _prefs._exportFile = QFileDialog::getSaveFileName(this, QStringLiteral("Save matches to file"), QStringLiteral(""),
+                                                      QStringLiteral("JSON Lines (*.jsonl);;CSV (*.csv)"));
+    if(_prefs._exportFile.isEmpty())
+        addStatusMessage(QStringLiteral("\nMatching videos will not be saved to file"));
+    else
+        addStatusMessage(QStringLiteral("\nMatching videos will be saved to %1 when comparing")
+                         .arg(QDir::toNativeSeparators(_prefs._exportFile)));
+}
+
+void MainWindow::on_actionImportMatches_triggered()
+{
+    const QString filename = QFileDialog::getOpenFileName(this, QStringLiteral("Open matches file"), QStringLiteral(""),
+                             QStringLiteral("Matches (*.jsonl *.csv);;All files (*)"));
+    if(filename.isEmpty() || ui->findDuplicates->text() == QLatin1String("Stop"))
+        return;
+
+    QStringList filenames;
+    QVector<int64_t> durations;
+    QVector<Match> matches;
+    int thumbnails = -1;
+    MatchFile matchFile(filename);
+    if(!matchFile.read(filenames, durations, matches, thumbnails) || matches.isEmpty())
+    {
+        addStatusMessage(QStringLiteral("Error: no matching videos in %1").arg(QDir::toNativeSeparators(filename)));
+        return;
+    }
+
+    Prefs imported = _prefs;                        //thumbnails are made of the screen captures pairs were found with
+    if(thumbnails >= thumb1 && thumbnails <= cutEnds)
+        imported._thumbnails = thumbnails;
+    imported._exportFile.clear();                   //imported pairs are not saved again
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    _sessionWriter.begin(imported);
+    for(int i=0; i<filenames.count(); i++)          //imported videos replace those of previous search
+    {
+        Video video(imported, filenames[i]);
+        video.duration = durations[i];
+        video.loadFromCache();
+        _sessionWriter.add(video);
+    }
+    _sessionWriter.finish(_session, QStringLiteral(""));
+    _previousRunFolders = QStringLiteral("");       //next search must find videos again
+    _previousRunQuery = QStringLiteral("");
+    _prefs._numberOfVideos = imported._numberOfVideos = _session.count();
+    QApplication::restoreOverrideCursor();
+    addStatusMessage(QStringLiteral("\nOpened %1 matching pair(s) of %2 video(s) from %3")
+                     .arg(matches.count()).arg(filenames.count()).arg(QDir::toNativeSeparators(filename)));
+
+    Comparison comparison(_session, imported, matches);
+    comparison.reportMatchingVideos();
+    comparison.exec();
+}
+
+void MainWindow::on_actionSaveSession_triggered()
+{
+    if(_session.count() == 0)
+    {
+        addStatusMessage(QStringLiteral("\nNothing to save, search for videos first"));
+        return;
+    }
+    const QString filename = QFileDialog::getSaveFileName(this, QStringLiteral("Save session"), QStringLiteral(""),
+                                                          QStringLiteral("Vidupe session (*.vidupe)"));
+    if(filename.isEmpty())
+        return;
+    if(_session.save(filename))
+        addStatusMessage(QStringLiteral("\nSession of %1 video(s) saved to %2")
+                         .arg(_session.count()).arg(QDir::toNativeSeparators(filename)));
+    else
+        addStatusMessage(QStringLiteral("Error: could not save session to %1").arg(QDir::toNativeSeparators(filename)));
+}
+
+void MainWindow::on_actionOpenSession_triggered()
+{
+    const QString filename = QFileDialog::getOpenFileName(this, QStringLiteral("Open session"), QStringLiteral(""),
+                             QStringLiteral("Vidupe session (*.vidupe);;All files (*)"));
+    if(filename.isEmpty() || ui->findDuplicates->text() == QLatin1String("Stop"))
+        return;
+
+    if(!_session.load(filename))
+    {
+        addStatusMessage(QStringLiteral("Error: %1 is not a Vidupe session").arg(QDir::toNativeSeparators(filename)));
+        return;
+    }
+    _prefs._thumbnails = _session.thumbnailMode();      //fingerprints are only comparable with same settings
+    _prefs._hashAlgorithm = _session.hashAlgorithm();
+    ui->selectThumbnails->setCurrentIndex(_prefs._thumbnails);
+    ui->selectHash->setCurrentIndex(_prefs._hashAlgorithm);
+    ui->directoryBox->setText(_session.folders());
+    ui->queryBox->setText(_session.queryFolders());
+    _previousRunFolders = _session.folders();           //pressing "find duplicates" compares session right away
+    _previousRunQuery = _session.queryFolders();
+    _previousRunThumbnails = _prefs._thumbnails;
+    _previousRunHash = _prefs._hashAlgorithm;
+    _previousRunAudio = _prefs._audioFingerprint;
+    _prefs._numberOfVideos = _session.count();
+    addStatusMessage(QStringLiteral("\nOpened session of %1 video(s) from %2")
+                     .arg(_session.count()).arg(QDir::toNativeSeparators(filename)));
+}
+
 void MainWindow::on_findDuplicates_clicked()
 {
     if(ui->findDuplicates->text() == QLatin1String("Stop"))     //pressing "find duplicates" button will morph into a
     {                                                           //stop button. a lengthy search can thus be stopped and
         _userPressedStop = true;                                //those videos already processed are compared w/each other
+        Video::abortProcessing(true);                           //running captures are killed
+        _session.candidates().cancelBuild(true);                //comparing pairs in background is not finished
         return;
     }
     else
     {
         ui->findDuplicates->setText(QStringLiteral("Stop"));
         _userPressedStop = false;
+        Video::abortProcessing(false);                          //stop pressed while comparing is still set
     }
     if(_extensionList.isEmpty())
     {
@@ -151,53 +397,90 @@ void MainWindow::on_findDuplicates_clicked()
         return;
 
     const QString foldersToSearch = ui->directoryBox->text();   //search only if folder or thumbnail settings have changed
-    if(foldersToSearch != _previousRunFolders || _prefs._thumbnails != _previousRunThumbnails)
+    const QString queryFolders = ui->queryBox->text();
+    const bool newSearch = foldersToSearch != _previousRunFolders || queryFolders != _previousRunQuery ||
+                           _prefs._thumbnails != _previousRunThumbnails ||
+                           _prefs._hashAlgorithm != _previousRunHash || _prefs._audioFingerprint != _previousRunAudio;
+    if(newSearch)
     {
-        ui->statusBox->append(QStringLiteral("\nSearching for videos..."));
+        addStatusMessage(QStringLiteral("\nSearching for videos..."));
         ui->statusBar->setVisible(true);
 
-        for(const auto &video : _videoList)                     //new search: delete videos from previous search
-            delete video;
-        _videoList.clear();
+        _session.close();                                       //new search: forget videos from previous search
         _everyVideo.clear();
 
-        const QStringList directories = foldersToSearch.split(QStringLiteral(";"));
         QString notFound;
-        for(auto directory : directories)               //add all video files from entered paths to list
+        auto searchFolders = [&](const QString &folders)
         {
-            if(directory.isEmpty())
-                continue;
-            QDir dir = directory.remove(QStringLiteral("\""));
-            if(dir.exists())
-                findVideos(dir);
-            else
+            const QStringList directories = folders.split(QStringLiteral(";"));
+            for(auto directory : directories)           //add all video files from entered paths to list
             {
-                addStatusMessage(QStringLiteral("Cannot find folder: %1").arg(QDir::toNativeSeparators(dir.path())));
-                notFound += QStringLiteral("%1 ").arg(QDir::toNativeSeparators(dir.path()));
+                if(directory.isEmpty())
+                    continue;
+                QDir dir = directory.remove(QStringLiteral("\""));
+                if(dir.exists())
+                    findVideos(dir);
+                else
+                {
+                    addStatusMessage(QStringLiteral("Cannot find folder: %1").arg(QDir::toNativeSeparators(dir.path())));
+                    notFound += QStringLiteral("%1 ").arg(QDir::toNativeSeparators(dir.path()));
+                }
             }
-        }
+        };
+        searchFolders(foldersToSearch);
+        const int firstQuery = _everyVideo.count();             //a video in both is library, found first
+        searchFolders(queryFolders);
+        QSet<QString> queryVideos;
+        for(int video=firstQuery; video<_everyVideo.count(); video++)
+            queryVideos << _everyVideo[video];
         if(!notFound.isEmpty())
             ui->statusBar->showMessage(QStringLiteral("Cannot find folder: %1").arg(notFound));
 
-        processVideos();
+        _sessionWriter.begin(_prefs, queryVideos);              //thumbnails and fingerprints are kept on disk,
+        processVideos();                                        //comparison works from memory-mapped session
+        _sessionWriter.finish(_session, foldersToSearch, queryVideos.isEmpty()? QString() : queryFolders);
+        _prefs._numberOfVideos = _session.count();
     }
 
-    if(_videoList.count() > 1)
+    if(_session.count() > 1)
     {
-        Comparison comparison(_videoList, _prefs);
-        if(foldersToSearch != _previousRunFolders || _prefs._thumbnails != _previousRunThumbnails)
-        {
-            QFuture<void> future = QtConcurrent::run(&comparison, &Comparison::reportMatchingVideos);   //run in background
-            comparison.exec();          //open dialog, but if it is closed while reportMatchingVideos() still running...
-            QApplication::setOverrideCursor(Qt::WaitCursor);
-            future.waitForFinished();   //...must wait until finished (crash when going out of scope destroys instance)
-            QApplication::restoreOverrideCursor();
+        if(!_session.candidates().covers(_prefs))              //every pair is compared once in background,
+        {                                                       //changing threshold later only filters them
+            if(_session.queryCount())
+                addStatusMessage(QStringLiteral("\n[%1] Comparing %2 query video(s) with %3 video(s)")
+                                 .arg(QTime::currentTime().toString()).arg(_session.queryCount()).arg(_session.count()));
+            else
+                addStatusMessage(QStringLiteral("\n[%1] Comparing %2 video(s) with each other")
+                                 .arg(QTime::currentTime().toString()).arg(_session.count()));
+            QFutureWatcher<void> comparing;
+            QEventLoop waitUntilCompared;
+            connect(&comparing, &QFutureWatcher<void>::finished, &waitUntilCompared, &QEventLoop::quit);
+            _session.candidates().cancelBuild(false);           //stop pressed from here on stops comparing
+            comparing.setFuture(QtConcurrent::run([this]() { _session.candidates().build(_session, _prefs); }));
+            waitUntilCompared.exec();
+
+            const int64_t queries = _session.queryCount();     //query mode skips library pairs
+            const int64_t allPairs = queries? queries * (_session.count() - queries) + queries * (queries - 1) / 2 :
+                                              static_cast<int64_t>(_session.count()) * (_session.count() - 1) / 2;
+            if(!_session.candidates().covers(_prefs))           //stopped or closed while comparing
+                addStatusMessage(QStringLiteral("Comparing was stopped"));
+            else if(_session.candidates().comparedPairs() < allPairs)
+                addStatusMessage(QStringLiteral("%1 of %2 pairs were compared, others differ too much in duration")
+                                 .arg(_session.candidates().comparedPairs()).arg(allPairs));
         }
-        else
+
+        if(_session.candidates().covers(_prefs))
+        {
+            Comparison comparison(_session, _prefs);
+            comparison.reportMatchingVideos();
             comparison.exec();
+        }
 
-        _previousRunFolders = foldersToSearch;                  //videos are still held in memory until
+        _previousRunFolders = foldersToSearch;                  //session is kept until
+        _previousRunQuery = queryFolders;
         _previousRunThumbnails = _prefs._thumbnails;            //folders to search or thumbnail mode are changed
+        _previousRunHash = _prefs._hashAlgorithm;
+        _previousRunAudio = _prefs._audioFingerprint;
     }
 
     ui->findDuplicates->setText(QStringLiteral("Find duplicates"));
@@ -207,6 +490,8 @@ void MainWindow::findVideos(QDir &dir)
 {
     dir.setNameFilters(_extensionList);
     QDirIterator iter(dir, QDirIterator::Subdirectories);
+    QElapsedTimer sinceEvents;
+    sinceEvents.start();
     while(iter.hasNext())
     {
         if(_userPressedStop)
@@ -224,18 +509,25 @@ void MainWindow::findVideos(QDir &dir)
         if(!duplicate)
             _everyVideo << filename;
 
-        ui->statusBar->showMessage(QDir::toNativeSeparators(filename), 10);
-        QApplication::processEvents();
+        if(sinceEvents.elapsed() >= _flushInterval)         //GUI is updated at fixed rate, not for every file
+        {
+            ui->statusBar->showMessage(QDir::toNativeSeparators(filename), _flushInterval);
+            QApplication::processEvents();
+            sinceEvents.restart();
+        }
     }
 }
 
 void MainWindow::processVideos()
 {
     _prefs._numberOfVideos = _everyVideo.count();
-    ui->statusBox->append(QStringLiteral("Found %1 video file(s):").arg(_prefs._numberOfVideos));
+    addStatusMessage(QStringLiteral("Found %1 video file(s):").arg(_prefs._numberOfVideos));
+    _processedVideos = 0;
     if(_prefs._numberOfVideos > 0)
     {
         ui->selectThumbnails->setDisabled(true);
+        ui->selectHash->setDisabled(true);
+        ui->audioFingerprint->setDisabled(true);
         ui->processedFiles->setVisible(true);
         ui->processedFiles->setText(QStringLiteral("0/%1").arg(_prefs._numberOfVideos));
         if(ui->statusBar->currentMessage().indexOf(QStringLiteral("Cannot find folder")) == -1)
@@ -247,16 +539,46 @@ void MainWindow::processVideos()
     }
     else return;
 
+    QFutureWatcher<QStringList> finding;            //byte-identical files are processed once, found before decoding
+    QEventLoop waitUntilFound;
+    connect(&finding, &QFutureWatcher<QStringList>::finished, &waitUntilFound, &QEventLoop::quit);
+    finding.setFuture(QtConcurrent::run([this]()
+    {
+        Db::preload(_prefs._hashAlgorithm);         //whole cache index in one read, not a query per video
+        return _exactCopies.find(_everyVideo);
+    }));
+    waitUntilFound.exec();
+    const QStringList toProcess = finding.result();
+    if(_exactCopies.count())
+    {
+        addStatusMessage(QStringLiteral("%1 exact copies found, only one of each is processed:").arg(_exactCopies.count()));
+        const QHash<QString, QStringList> &copies = _exactCopies.copies();
+        for(auto original=copies.cbegin(); original!=copies.cend(); original++)
+        {
+            addStatusMessage(QDir::toNativeSeparators(original.key()));
+            for(const auto &copy : original.value())
+                addStatusMessage(QStringLiteral("  = %1").arg(QDir::toNativeSeparators(copy)));
+        }
+        ui->progressBar->setMaximum(toProcess.count());
+        ui->processedFiles->setText(QStringLiteral("0/%1").arg(toProcess.count()));
+    }
+
+    Governor governor;
     QThreadPool threadPool;
-    for(const auto &filename : _everyVideo)
+    threadPool.setMaxThreadCount(governor.workers());
+    for(const auto &filename : toProcess)
     {
         if(_userPressedStop)
         {
             threadPool.clear();
             break;
         }
-        while(threadPool.activeThreadCount() == threadPool.maxThreadCount())
+        while(threadPool.activeThreadCount() >= threadPool.maxThreadCount())
+        {
             QApplication::processEvents();          //avoid blocking signals in event loop
+            if(governor.adapt())
+                threadPool.setMaxThreadCount(governor.workers());
+        }
 
         auto *videoTask = new Video(_prefs, filename);
         videoTask->setAutoDelete(false);
@@ -264,12 +586,16 @@ void MainWindow::processVideos()
     }
     threadPool.waitForDone();
     QApplication::processEvents();                  //process signals from last threads
+    Db::releasePreload();
+    Video::abortProcessing(false);                  //zoom captures in comparison window must not be stopped
 
     ui->selectThumbnails->setDisabled(false);
+    ui->selectHash->setDisabled(false);
+    ui->audioFingerprint->setDisabled(false);
     ui->processedFiles->setVisible(false);
     ui->progressBar->setVisible(false);
     ui->statusBar->setVisible(false);
-    _prefs._numberOfVideos = _videoList.count();    //minus rejected ones now
+    _prefs._numberOfVideos = _sessionWriter.count();    //minus rejected ones now
     videoSummary();
 }
 
@@ -291,25 +617,63 @@ void MainWindow::videoSummary()
 
 void MainWindow::addStatusMessage(const QString &message) const
 {
-    ui->statusBox->append(message);
-    ui->statusBox->repaint();
+    _pendingMessages << message;
+    if(_log.device())
+        _log << message << '\n';
+}
+
+void MainWindow::flushStatus()
+{                                                   //fixed cost per interval, however many videos were processed
+    if(!_pendingMessages.isEmpty())
+    {
+        ui->statusBox->append(_pendingMessages.join('\n'));
+        _pendingMessages.clear();
+    }
+    if(ui->progressBar->isVisible() && ui->progressBar->value() != _processedVideos)
+    {
+        ui->progressBar->setValue(_processedVideos);
+        ui->processedFiles->setText(QStringLiteral("%1/%2").arg(_processedVideos).arg(ui->progressBar->maximum()));
+    }
+    if(_log.device())
+        _log.flush();
+}
+
+bool MainWindow::setLogFile(const QString &filename)
+{
+    _logFile.setFileName(filename);
+    if(!_logFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        return false;
+    _log.setDevice(&_logFile);
+    _log.setCodec("UTF-8");
+    return true;
 }
 
 void MainWindow::addVideo(Video *addMe)
 {
     addStatusMessage(QStringLiteral("[%1] %2").arg(QTime::currentTime().toString(),
                                                    QDir::toNativeSeparators(addMe->filename)));
-    ui->progressBar->setValue(ui->progressBar->value() + 1);
-    ui->processedFiles->setText(QStringLiteral("%1/%2").arg(ui->progressBar->value()).arg(ui->progressBar->maximum()));
-    _videoList << addMe;
+    _processedVideos++;
+    _sessionWriter.add(*addMe);
+    for(const auto &copy : _exactCopies.copies().value(addMe->filename))
+        _sessionWriter.add(*addMe, copy);           //copies share fingerprints of intact original
+    delete addMe;
 }
 
 void MainWindow::removeVideo(Video *deleteMe)
 {
-    addStatusMessage(QStringLiteral("[%1] ERROR reading %2").arg(QTime::currentTime().toString(),
-                                                                 QDir::toNativeSeparators(deleteMe->filename)));
-    ui->progressBar->setValue(ui->progressBar->value() + 1);
-    ui->processedFiles->setText(QStringLiteral("%1/%2").arg(ui->progressBar->value()).arg(ui->progressBar->maximum()));
-    _rejectedVideos << QDir::toNativeSeparators(deleteMe->filename);
+    if(!Video::aborted())                           //videos stopped while processing were not faulty
+    {
+        addStatusMessage(QStringLiteral("[%1] ERROR reading %2").arg(QTime::currentTime().toString(),
+                                                                     QDir::toNativeSeparators(deleteMe->filename)));
+        _rejectedVideos << QDir::toNativeSeparators(deleteMe->filename);
+        for(const auto &copy : _exactCopies.copies().value(deleteMe->filename))
+        {                                           //byte-identical copies fail the same way
+            addStatusMessage(QStringLiteral("[%1] ERROR reading %2 (copy of %3)")
+                             .arg(QTime::currentTime().toString(), QDir::toNativeSeparators(copy),
+                                  QDir::toNativeSeparators(deleteMe->filename)));
+            _rejectedVideos << QDir::toNativeSeparators(copy);
+        }
+    }
+    _processedVideos++;
     delete deleteMe;
 }
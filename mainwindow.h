@@ -3,8 +3,12 @@
 
 #include <QDragEnterEvent>
 #include <QMimeData>
+#include <QTimer>
+#include <QTextStream>
 #include "ui_mainwindow.h"
 #include "video.h"
+#include "session.h"
+#include "exactcopies.h"
 
 namespace Ui { class MainWindow; }
 
@@ -14,24 +18,42 @@ class MainWindow : public QMainWindow
 
 public:
     MainWindow();
-    ~MainWindow() { deleteTemporaryFiles(); delete ui; }
+    ~MainWindow() { deleteTemporaryFiles(); _log.flush(); delete ui; }
+
+    //status messages are also written to file, with lines dropped from status box. returns false if not opened
+    bool setLogFile(const QString &filename);
 
 private:
     Ui::MainWindow *ui;
 
-    QVector<Video *> _videoList;
+    SessionWriter _sessionWriter;                   //accepted videos are written to session and deleted right away
+    Session _session;
+    ExactCopies _exactCopies;
     QStringList _everyVideo;
     QStringList _rejectedVideos;
     QStringList _extensionList;
 
     Prefs _prefs;
     bool _userPressedStop = false;
+
+    mutable QStringList _pendingMessages;           //status lines shown at next flush, not repainted one by one
+    int _processedVideos = 0;                       //progress shown at next flush
+    QTimer _flushTimer;
+    QFile _logFile;
+    mutable QTextStream _log;
+
+    static constexpr int _flushInterval = 100;      //ms between updates of status box and progress bar
+    static constexpr int _statusLines = 5000;       //oldest lines are dropped from status box, all kept in log file
     QString _previousRunFolders = QStringLiteral("");
+    QString _previousRunQuery = QStringLiteral("");
     int _previousRunThumbnails = -1;
+    int _previousRunHash = -1;
+    bool _previousRunAudio = false;
 
 private slots:
     void deleteTemporaryFiles() const;
-    void closeEvent(QCloseEvent *event) { Q_UNUSED (event) _userPressedStop = true; }
+    void closeEvent(QCloseEvent *event) { Q_UNUSED (event) _userPressedStop = true; Video::abortProcessing(true);
+                                          _session.candidates().cancelBuild(true); }
     void dragEnterEvent(QDragEnterEvent *event) { if(event->mimeData()->hasUrls()) event->acceptProposedAction(); }
     void dropEvent(QDropEvent *event);
     void loadExtensions();
@@ -40,22 +62,31 @@ private slots:
     void setComparisonMode(const int &mode) { if(mode == _prefs._PHASH) ui->selectPhash->click(); else ui->selectSSIM->click(); ui->directoryBox->setFocus(); }
     void on_selectThumbnails_activated(const int &index) { ui->directoryBox->setFocus(); _prefs._thumbnails = index;
                                                            if(_prefs._thumbnails == cutEnds) ui->differentDurationCombo->setCurrentIndex(0); }
+    void on_selectHash_activated(const int &index) { ui->directoryBox->setFocus(); _prefs._hashAlgorithm = index; }
+    void on_audioFingerprint_clicked(const bool &checked) { ui->directoryBox->setFocus(); _prefs._audioFingerprint = checked; }
     void on_selectPhash_clicked(const bool &checked) { if(checked) _prefs._comparisonMode = _prefs._PHASH; ui->directoryBox->setFocus(); }
     void on_selectSSIM_clicked(const bool &checked) { if(checked) _prefs._comparisonMode = _prefs._SSIM; ui->directoryBox->setFocus(); }
     void on_blocksizeCombo_activated(const int &index) { _prefs._ssimBlockSize = static_cast<int>(pow(2, index+1)); ui->directoryBox->setFocus(); }
     void on_differentDurationCombo_activated(const int &index) { _prefs._differentDurationModifier = index; ui->directoryBox->setFocus(); }
     void on_sameDurationCombo_activated(const int &index) { _prefs._sameDurationModifier = index; ui->directoryBox->setFocus(); }
+    void on_durationWindowCombo_activated(const int &index);
     void on_thresholdSlider_valueChanged(const int &value) { ui->thresholdSlider->setValue(value); calculateThreshold(value); ui->directoryBox->setFocus(); }
     void calculateThreshold(const int &value);
 
     void on_browseFolders_clicked() const;
+    void on_actionExportMatches_triggered();
+    void on_actionImportMatches_triggered();
+    void on_actionSaveSession_triggered();
+    void on_actionOpenSession_triggered();
     void on_directoryBox_returnPressed() { on_findDuplicates_clicked(); }
+    void on_queryBox_returnPressed() { on_findDuplicates_clicked(); }
     void on_findDuplicates_clicked();
     void findVideos(QDir &dir);
     void processVideos();
     void videoSummary();
 
     void addStatusMessage(const QString &message) const;
+    void flushStatus();
     void addVideo(Video *addMe);
     void removeVideo(Video *deleteMe);
 };
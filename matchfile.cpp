@@ -0,0 +1,152 @@
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "matchfile.h"
+#include "session.h"
+
+MatchFile::MatchFile(const QString &filename) : _file(filename)
+{
+    _csv = filename.endsWith(QStringLiteral(".csv"), Qt::CaseInsensitive);
+}
+
+bool MatchFile::openForWriting(const bool &append)
+{
+    if(!_file.open(QIODevice::WriteOnly | (append? QIODevice::Append : QIODevice::Truncate) | QIODevice::Text))
+        return false;
+    _stream.setDevice(&_file);
+    _stream.setCodec("UTF-8");
+    if(_csv && _file.size() == 0)
+        _stream << "left,leftSize,leftDuration,right,rightSize,rightDuration,distance,ssim,thumbnails\n";
+    return true;
+}
+
+void MatchFile::write(const Session &session, const int &left, const int &right, const int &distance, const double &ssim)
+{
+    write(session.filename(left), session.size(left), session.duration(left),
+          session.filename(right), session.size(right), session.duration(right), distance, ssim,
+          session.thumbnailMode());
+}
+
+void MatchFile::write(const QString &left, const int64_t &leftSize, const int64_t &leftDuration,
+                      const QString &right, const int64_t &rightSize, const int64_t &rightDuration,
+                      const int &distance, const double &ssim, const int &thumbnails)
+{
+    if(_csv)
+    {
+        _stream << csvField(left) << ',' << leftSize << ',' << leftDuration << ','
+                << csvField(right) << ',' << rightSize << ',' << rightDuration << ','
+                << distance << ',' << (ssim < 0? QStringLiteral("") : QString::number(ssim, 'f', 4)) << ','
+                << thumbnails << '\n';
+        return;
+    }
+
+    QJsonObject line;
+    line.insert(QStringLiteral("left"), left);
+    line.insert(QStringLiteral("leftSize"), static_cast<double>(leftSize));
+    line.insert(QStringLiteral("leftDuration"), static_cast<double>(leftDuration));
+    line.insert(QStringLiteral("right"), right);
+    line.insert(QStringLiteral("rightSize"), static_cast<double>(rightSize));
+    line.insert(QStringLiteral("rightDuration"), static_cast<double>(rightDuration));
+    line.insert(QStringLiteral("distance"), distance);
+    line.insert(QStringLiteral("ssim"), ssim < 0? QJsonValue() : QJsonValue(ssim));
+    line.insert(QStringLiteral("thumbnails"), thumbnails);
+    _stream << QJsonDocument(line).toJson(QJsonDocument::Compact) << '\n';
+}
+
+bool MatchFile::read(QStringList &filenames, QVector<int64_t> &durations, QVector<Match> &matches, int &thumbnails)
+{
+    thumbnails = -1;                            //files written before the mode was saved do not have it
+    if(!_file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    _stream.setDevice(&_file);
+    _stream.setCodec("UTF-8");
+
+    QHash<QString, int> indexOf;                //same video can be in many pairs
+    auto videoIndex = [&](const QString &filename, const int64_t &duration)
+    {
+        if(!indexOf.contains(filename))
+        {
+            indexOf.insert(filename, filenames.count());
+            filenames << filename;
+            durations << duration;
+        }
+        return indexOf.value(filename);
+    };
+
+    auto otherMode = [&thumbnails](const int &lineThumbnails)
+    {                                           //appended by a run with another mode, its screen captures differ
+        if(thumbnails < 0)
+            thumbnails = lineThumbnails;
+        return lineThumbnails >= 0 && lineThumbnails != thumbnails;
+    };
+
+    if(_csv)
+        _stream.readLine();                     //skip header
+    while(!_stream.atEnd())
+    {
+        const QString line = _stream.readLine();
+        if(line.isEmpty())
+            continue;
+        Match match;
+        if(_csv)
+        {
+            const QStringList fields = splitCsvLine(line);
+            if(fields.count() < 8 || otherMode(fields.count() > 8? fields[8].toInt() : -1))
+                continue;
+            match.left = videoIndex(fields[0], fields[2].toLongLong());
+            match.right = videoIndex(fields[3], fields[5].toLongLong());
+            match.distance = fields[6].toInt();
+            match.ssim = fields[7].isEmpty()? -1 : fields[7].toDouble();
+        }
+        else
+        {
+            const QJsonObject object = QJsonDocument::fromJson(line.toUtf8()).object();
+            if(object.isEmpty() || otherMode(object.value(QStringLiteral("thumbnails")).toInt(-1)))
+                continue;
+            match.left = videoIndex(object.value(QStringLiteral("left")).toString(),
+                                    static_cast<int64_t>(object.value(QStringLiteral("leftDuration")).toDouble()));
+            match.right = videoIndex(object.value(QStringLiteral("right")).toString(),
+                                     static_cast<int64_t>(object.value(QStringLiteral("rightDuration")).toDouble()));
+            match.distance = object.value(QStringLiteral("distance")).toInt();
+            match.ssim = object.value(QStringLiteral("ssim")).toDouble(-1);
+        }
+        matches << match;
+    }
+    return true;
+}
+
+QStringList MatchFile::splitCsvLine(const QString &line) const
+{
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    for(int i=0; i<line.length(); i++)
+    {
+        const QChar c = line[i];
+        if(quoted)
+        {
+            if(c == '"' && i+1 < line.length() && line[i+1] == '"')
+                field += line[++i];                         //"" is an escaped quote
+            else if(c == '"')
+                quoted = false;
+            else
+                field += c;
+        }
+        else if(c == '"')
+            quoted = true;
+        else if(c == ',')
+        {
+            fields << field;
+            field.clear();
+        }
+        else
+            field += c;
+    }
+    fields << field;
+    return fields;
+}
+
+QString MatchFile::csvField(const QString &field) const
+{
+    QString escaped = field;
+    return QStringLiteral("\"%1\"").arg(escaped.replace(QStringLiteral("\""), QStringLiteral("\"\"")));
+}
@@ -0,0 +1,55 @@
+#ifndef MATCHFILE_H
+#define MATCHFILE_H
+
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+
+class Session;
+
+struct Match
+{
+    int left = 0;                   //indexes of videos
+    int right = 0;
+    int distance = 0;               //differing bits of 64
+    double ssim = -1;               //negative if SSIM was not computed
+};
+
+inline bool operator<(const Match &a, const Match &b)       //in order of left video, then right video
+{
+    return a.left < b.left || (a.left == b.left && a.right < b.right);
+}
+
+class MatchFile
+{
+
+public:
+    explicit MatchFile(const QString &filename);
+
+private:
+    QFile _file;
+    QTextStream _stream;
+    bool _csv = false;              //file extension decides format, JSON Lines unless .csv
+
+    QStringList splitCsvLine(const QString &line) const;
+    QString csvField(const QString &field) const;
+
+public:
+    //truncate file and write header (CSV only). if appending, earlier pairs are kept
+    bool openForWriting(const bool &append = false);
+
+    //append one matching pair. written lines are buffered, not kept in memory
+    void write(const Session &session, const int &left, const int &right, const int &distance, const double &ssim);
+    void write(const QString &left, const int64_t &leftSize, const int64_t &leftDuration,
+               const QString &right, const int64_t &rightSize, const int64_t &rightDuration,
+               const int &distance, const double &ssim, const int &thumbnails);
+
+    //write buffered pairs to file now
+    void flush() { _stream.flush(); }
+
+    //read all pairs, filenames and durations are indexed by Match::left and Match::right. thumbnails is the mode
+    //pairs were found with, -1 if file does not tell. pairs found with another mode than the first one are skipped
+    bool read(QStringList &filenames, QVector<int64_t> &durations, QVector<Match> &matches, int &thumbnails);
+};
+
+#endif // MATCHFILE_H
@@ -0,0 +1,159 @@
+#include <QFileInfo>
+#include <QDir>
+#include "pack.h"
+
+constexpr qint64 Pack::_maxSize;
+QMutex Pack::_mutex;
+QHash<QString, Pack::Packs> Pack::_packs;
+
+QString Pack::filename(const QString &cacheFile, const int &pack)
+{
+    const QFileInfo cache(cacheFile);
+    return QStringLiteral("%1/%2.%3.pack").arg(cache.path(), cache.completeBaseName()).arg(pack);
+}
+
+int Pack::newest(const QString &cacheFile)
+{
+    const QFileInfo cache(cacheFile);
+    const QStringList packFiles = cache.dir().entryList(QStringList(QStringLiteral("%1.*.pack")
+                                                                    .arg(cache.completeBaseName())), QDir::Files);
+    int newest = -1;
+    for(const auto &packFile : packFiles)
+    {
+        bool number = false;
+        const int pack = packFile.section('.', -2, -2).toInt(&number);
+        if(number && filename(cacheFile, pack) == cache.dir().filePath(packFile))
+            newest = qMax(newest, pack);
+    }
+    return newest;
+}
+
+Pack::Packs &Pack::packsOf(const QString &cacheFile)
+{
+    if(!_packs.contains(cacheFile))
+        _packs[cacheFile].newest = newest(cacheFile);
+    return _packs[cacheFile];
+}
+
+bool Pack::openNewest(const QString &cacheFile, Packs &packs, const bool &startNew)
+{
+    if(packs.writing)
+    {
+        packs.writing->close();
+        delete packs.writing;
+        packs.writing = nullptr;
+    }
+    if(startNew || packs.newest < 0)
+        packs.newest++;
+    packs.writing = new QFile(filename(cacheFile, packs.newest));
+    if(packs.writing->open(QIODevice::ReadWrite))
+        return true;
+    delete packs.writing;
+    packs.writing = nullptr;
+    return false;
+}
+
+bool Pack::append(const QString &cacheFile, const QByteArray &data, int &pack, qint64 &offset)
+{
+    QMutexLocker lock(&_mutex);
+    Packs &packs = packsOf(cacheFile);
+    if(!packs.appending)
+        packs.appending = new QLockFile(QStringLiteral("%1.lock").arg(cacheFile));
+    if(!packs.appending->lock())                //waits for other process, lock of a crashed one is removed
+        return false;
+    const bool appended = appendLocked(cacheFile, packs, data, pack, offset);
+    packs.appending->unlock();
+    return appended;
+}
+
+bool Pack::appendLocked(const QString &cacheFile, Packs &packs, const QByteArray &data, int &pack, qint64 &offset)
+{
+    const int newestOnDisk = newest(cacheFile); //another process may have started a new pack
+    if(newestOnDisk > packs.newest)
+    {
+        packs.newest = newestOnDisk;
+        if(!openNewest(cacheFile, packs, false))
+            return false;
+    }
+    if(!packs.writing && !openNewest(cacheFile, packs, false))
+        return false;
+    if(packs.writing->size() >= _maxSize && !openNewest(cacheFile, packs, true))
+        return false;
+
+    pack = packs.newest;
+    offset = packs.writing->size();             //size on disk, includes appends of other processes
+    if(!packs.writing->seek(offset) || packs.writing->write(data) != data.size())
+    {
+        packs.writing->resize(offset);          //cut partial write, offset is used again
+        return false;
+    }
+    packs.writing->flush();                     //capture must be in pack before cache points to it
+    return true;
+}
+
+QByteArray Pack::read(const QString &cacheFile, const int &pack, const qint64 &offset, const int &length)
+{
+    if(pack < 0 || offset < 0 || length < 0)
+        return nullptr;
+    QMutexLocker lock(&_mutex);
+    Packs &packs = packsOf(cacheFile);
+
+    if(pack > packs.newest)                     //started by another process since
+    {
+        packs.newest = newest(cacheFile);
+        if(pack > packs.newest || !openNewest(cacheFile, packs, false))
+            return nullptr;
+    }
+    if(pack == packs.newest)                    //still growing, mapped part would not cover later appends
+    {
+        if(!packs.writing && !openNewest(cacheFile, packs, false))
+            return nullptr;
+        if(pack != packs.newest || offset + length > packs.writing->size() || !packs.writing->seek(offset))
+            return nullptr;
+        const QByteArray copy = packs.writing->read(length);
+        return copy.size() == length? copy : nullptr;
+    }
+
+    if(!packs.mapped.contains(pack))
+    {
+        auto *file = new QFile(filename(cacheFile, pack));
+        const uchar *data = file->open(QIODevice::ReadOnly) && file->size() > 0? file->map(0, file->size()) : nullptr;
+        if(!data)
+        {
+            delete file;
+            return nullptr;                     //not remembered, pack may be restored later
+        }
+        packs.mapped.insert(pack, file);
+        packs.data.insert(pack, data);
+    }
+    const qint64 size = packs.mapped.value(pack)->size();
+    const uchar *data = packs.data.value(pack);
+    lock.unlock();                              //mapping stays until close(), readers need not wait for each other
+
+    if(offset + length > size)
+        return nullptr;
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(data + offset), length);
+}
+
+void Pack::startNew(const QString &cacheFile)
+{
+    QMutexLocker lock(&_mutex);
+    Packs &packs = packsOf(cacheFile);
+    openNewest(cacheFile, packs, true);
+}
+
+void Pack::close(const QString &cacheFile)
+{
+    QMutexLocker lock(&_mutex);
+    if(!_packs.contains(cacheFile))
+        return;
+    Packs &packs = _packs[cacheFile];
+    for(auto pack=packs.mapped.begin(); pack!=packs.mapped.end(); pack++)
+    {
+        pack.value()->unmap(const_cast<uchar *>(packs.data.value(pack.key())));
+        delete pack.value();
+    }
+    delete packs.writing;
+    delete packs.appending;
+    _packs.remove(cacheFile);
+}
@@ -0,0 +1,58 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QLockFile>
+
+//screen captures of a cache file are appended to pack files next to it (cache.0.pack, cache.1.pack...), the cache
+//only keeps where each one is. a full pack is never written again, so it is memory-mapped once and read in place. the
+//newest pack is still growing and is read with a copy. replaced and removed captures stay in packs until compacted
+//
+//processes sharing a cache file (GUI, --watch, workers without shards) take turns appending through a lock file
+
+class Pack
+{
+
+public:
+    static constexpr qint64 _maxSize = 256 * 1024 * 1024;    //bytes, next capture goes to new pack after this
+
+private:
+    struct Packs                                //files of one cache file
+    {
+        int newest = -1;                        //pack being appended to, -1 if none yet
+        QFile *writing = nullptr;
+        QLockFile *appending = nullptr;         //held by one process while it appends
+        QHash<int, QFile *> mapped;             //full packs, mapped from beginning to end
+        QHash<int, const uchar *> data;
+    };
+
+    static QMutex _mutex;
+    static QHash<QString, Packs> _packs;
+
+    static Packs &packsOf(const QString &cacheFile);
+    static bool openNewest(const QString &cacheFile, Packs &packs, const bool &startNew);
+    static bool appendLocked(const QString &cacheFile, Packs &packs, const QByteArray &data, int &pack, qint64 &offset);
+
+public:
+    //name of nth pack of cache file
+    static QString filename(const QString &cacheFile, const int &pack);
+
+    //highest numbered pack file of cache file, -1 if there are none
+    static int newest(const QString &cacheFile);
+
+    //append data to newest pack, returns false if it was not written
+    static bool append(const QString &cacheFile, const QByteArray &data, int &pack, qint64 &offset);
+
+    //data in a full pack is not copied and stays valid until close(). null if out of range or pack is missing
+    static QByteArray read(const QString &cacheFile, const int &pack, const qint64 &offset, const int &length);
+
+    //appends that follow go to a new pack, even if newest one is not full
+    static void startNew(const QString &cacheFile);
+
+    //unmap and close packs of cache file, data read from them must not be used after this
+    static void close(const QString &cacheFile);
+};
+
+#endif // PACK_H
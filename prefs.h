@@ -8,10 +8,12 @@ class Prefs
 {
 public:
     enum _modes { _PHASH, _SSIM };
+    enum _hashAlgorithms { _DCT64, _DIFFERENCE, _AVERAGE, _WAVELET, _DCT256 };      //same order as in hasher.h
 
     QWidget *_mainwPtr = nullptr;               //pointer to MainWindow, for connecting signals to it's slots
 
     int _comparisonMode = _PHASH;
+    int _hashAlgorithm = _DCT64;
     int _thumbnails = cutEnds;
     int _numberOfVideos = 0;
     int _ssimBlockSize = 16;
@@ -21,6 +23,14 @@ public:
 
     int _differentDurationModifier = 4;
     int _sameDurationModifier = 1;
+
+    bool _audioFingerprint = false;             //audio sub-fingerprints are taken at capture points, if set
+    bool _grayCaptures = false;                 //ffmpeg outputs gray screen captures, cached as frame hashes only
+
+    int _durationWindowPercent = 10;            //only pairs this close in duration are compared, doubled in cutEnds
+    int _durationWindowSeconds = 0;             //mode. absolute window is used instead if set, both 0 = any duration
+
+    QString _exportFile;                        //matching pairs are saved here during comparison, if set
 };
 
 #endif // PREFS_H
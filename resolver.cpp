@@ -0,0 +1,170 @@
+#include <QtConcurrent/QtConcurrent>
+#include "resolver.h"
+#include "session.h"
+#include "comparison.h"
+
+Resolver::Resolver(const Session &sessionParam, const QVector<Rule> &rulesParam) :
+    _session(sessionParam), _rules(rulesParam)
+{
+}
+
+bool Resolver::better(const int &video, const int &other) const
+{
+    for(const auto &rule : _rules)
+    {
+        switch(rule)
+        {
+            case _RESOLUTION:
+            {
+                const int pixels = _session.width(video) * _session.height(video);
+                const int otherPixels = _session.width(other) * _session.height(other);
+                if(pixels != otherPixels)
+                    return pixels > otherPixels;
+                break;
+            }
+            case _BITRATE:
+                if(_session.bitrate(video) != _session.bitrate(other))
+                    return _session.bitrate(video) > _session.bitrate(other);
+                break;
+            case _OLDEST:
+                if(_session.modified(video) != _session.modified(other))
+                    return _session.modified(video) < _session.modified(other);
+                break;
+            case _LARGEST:
+                if(_session.size(video) != _session.size(other))
+                    return _session.size(video) > _session.size(other);
+                break;
+            case _LONGEST:                          //same as comparison window, within 1s is same duration
+                if(qAbs(_session.duration(video) - _session.duration(other)) > 1000)
+                    return _session.duration(video) > _session.duration(other);
+                break;
+        }
+    }
+    return false;
+}
+
+int Resolver::keeper(const QVector<int> &group) const
+{
+    int keep = -1;                                  //video deleted or moved meanwhile can not be kept
+    for(const auto &video : group)
+        if(QFileInfo::exists(_session.filename(video)) && (keep < 0 || better(video, keep)))
+            keep = video;
+    return keep;
+}
+
+QVector<Resolver::Action> Resolver::plan(const QVector< QVector<int> > &groups, const QVector<Match> &matches) const
+{
+    auto pairKey = [](const int &video, const int &other)
+        { return static_cast<quint64>(qMin(video, other)) << 32 | static_cast<quint64>(qMax(video, other)); };
+    QSet<quint64> matching;                         //groups are transitive, A~B and B~C puts A and C together
+    for(const auto &match : matches)
+        matching << pairKey(match.left, match.right);
+
+    QVector<Action> actions;
+    for(const auto &group : groups)
+    {
+        QVector<int> existing;
+        for(const auto &video : group)
+            if(QFileInfo::exists(_session.filename(video)))
+                existing << video;
+        if(existing.count() < 2)
+            continue;
+
+        Action action;
+        action.keep = keeper(existing);
+        for(const auto &video : existing)
+            if(video != action.keep)
+            {
+                action.video = video;
+                action.direct = matching.contains(pairKey(video, action.keep));
+                actions << action;
+            }
+    }
+    return actions;
+}
+
+QString Resolver::rules() const
+{
+    QStringList rules;
+    for(const auto &rule : _rules)
+        switch(rule)
+        {
+            case _RESOLUTION: rules << QStringLiteral("highest resolution"); break;
+            case _BITRATE:    rules << QStringLiteral("highest bitrate"); break;
+            case _OLDEST:     rules << QStringLiteral("oldest modified"); break;
+            case _LARGEST:    rules << QStringLiteral("largest file"); break;
+            case _LONGEST:    rules << QStringLiteral("longest duration"); break;
+        }
+    return rules.join(QStringLiteral(", then "));
+}
+
+QString Resolver::report(const QVector<Action> &actions) const
+{
+    QString report;
+    int kept = -1;
+    for(const auto &action : actions)               //actions of a group follow each other
+    {
+        if(action.keep != kept)
+        {
+            kept = action.keep;
+            report += QStringLiteral("%1Keep %2  (%3x%4, %5)\n").arg(report.isEmpty()? QStringLiteral("") : QStringLiteral("\n"),
+                      QDir::toNativeSeparators(_session.filename(kept))).arg(_session.width(kept))
+                      .arg(_session.height(kept)).arg(Comparison::readableBitRate(_session.bitrate(kept)));
+        }
+        report += QStringLiteral("  remove %1  (%2x%3, %4, %5)%6\n").arg(QDir::toNativeSeparators(_session.filename(action.video)))
+                  .arg(_session.width(action.video)).arg(_session.height(action.video))
+                  .arg(Comparison::readableBitRate(_session.bitrate(action.video)),
+                       Comparison::readableFileSize(_session.size(action.video)),
+                       action.direct? QStringLiteral("") : QStringLiteral("  NOT MATCHING KEPT VIDEO, only others of group"));
+    }
+    return report;
+}
+
+int64_t Resolver::reclaimed(const QVector<Action> &actions) const
+{
+    int64_t bytes = 0;
+    for(const auto &action : actions)
+        bytes += _session.size(action.video);
+    return bytes;
+}
+
+QVector<int> Resolver::execute(const QVector<Action> &actions, const QString &moveTo) const
+{
+    QStringList ids;                                //generated before files are gone
+    QStringList filenames;
+    QStringList keptFilenames;
+    for(const auto &action : actions)
+    {
+        keptFilenames << _session.filename(action.keep);
+        filenames << _session.filename(action.video);
+        ids << Db::videoId(filenames.last());
+    }
+
+    std::vector<char> done(static_cast<size_t>(actions.count()), 0);
+    QVector<int> indexes(actions.count());
+    for(int i=0; i<indexes.count(); i++)
+        indexes[i] = i;
+    QtConcurrent::blockingMap(indexes, [&](const int &i)
+    {
+        const QString &filename = filenames[i];
+        if(!QFileInfo::exists(keptFilenames[i]))   //last copy is never removed
+            done[static_cast<size_t>(i)] = false;
+        else if(moveTo.isEmpty())
+            done[static_cast<size_t>(i)] = QFile::remove(filename);
+        else
+            done[static_cast<size_t>(i)] = QFile::rename(filename, QStringLiteral("%1/%2").arg(moveTo,
+                                                                   QFileInfo(filename).fileName()));
+    });
+
+    QVector<int> videos;
+    QStringList removedIds;
+    for(int i=0; i<actions.count(); i++)
+        if(done[static_cast<size_t>(i)])
+        {
+            videos << actions[i].video;
+            removedIds << ids[i];
+        }
+    if(moveTo.isEmpty())                            //moved video keeps name and date, so its cache entry stays valid
+        Db::removeVideos(removedIds);
+    return videos;
+}
@@ -0,0 +1,59 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <QVector>
+#include <QString>
+#include "matchfile.h"
+
+class Session;
+
+//picks the video to keep in every group of matching videos. rules are tried in order, the first one telling two
+//videos apart decides, the same properties the comparison window highlights. the other videos of each group are
+//deleted or moved on background threads and their cache entries removed at once
+
+class Resolver
+{
+
+public:
+    enum Rule { _RESOLUTION, _BITRATE, _OLDEST, _LARGEST, _LONGEST };
+
+    struct Action
+    {
+        int video = 0;                          //deleted or moved
+        int keep = 0;                           //kept in its place
+        bool direct = true;                     //false if video matches kept one only through other videos of group
+    };
+
+    explicit Resolver(const Session &sessionParam,
+                      const QVector<Rule> &rulesParam = QVector<Rule>({ _RESOLUTION, _BITRATE, _OLDEST }));
+
+private:
+    const Session &_session;
+    QVector<Rule> _rules;
+
+    bool better(const int &video, const int &other) const;
+
+public:
+    //video of group kept by rules among those whose file still exists, first of them if all are alike. -1 if none exists
+    int keeper(const QVector<int> &group) const;
+
+    //every existing video of groups except the one kept. groups with less than two existing videos are skipped.
+    //matches tell which videos of a group matched the kept one directly
+    QVector<Action> plan(const QVector< QVector<int> > &groups, const QVector<Match> &matches) const;
+
+    //rules in readable form, e.g. "highest resolution, then highest bitrate, then oldest modified"
+    QString rules() const;
+
+    //dry run: one line per video kept and per video to be deleted or moved, nothing is touched
+    QString report(const QVector<Action> &actions) const;
+
+    //bytes freed if actions are carried out
+    int64_t reclaimed(const QVector<Action> &actions) const;
+
+    //delete videos, or move them to folder if moveTo is set. a video is left alone if the one kept instead is gone.
+    //files are handled in parallel, cache entries of those done are removed in one transaction. returns videos that
+    //were deleted or moved
+    QVector<int> execute(const QVector<Action> &actions, const QString &moveTo = QString()) const;
+};
+
+#endif // RESOLVER_H
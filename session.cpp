@@ -0,0 +1,303 @@
+#include <QTemporaryFile>
+#include <QSaveFile>
+#include <QDir>
+#include "session.h"
+#include "video.h"
+
+constexpr char Session::_magic[8];
+constexpr uint32_t Session::_version;
+
+bool SessionWriter::begin(const Prefs &prefs, const QSet<QString> &queryVideos)
+{
+    discard();
+
+    QTemporaryFile temporary(QStringLiteral("%1/Vidupe-session-XXXXXX").arg(QDir::tempPath()));
+    temporary.setAutoRemove(false);
+    if(!temporary.open())
+        return false;
+    _file.setFileName(temporary.fileName());
+    temporary.close();
+    if(!_file.open(QIODevice::ReadWrite))
+    {
+        QFile::remove(_file.fileName());
+        return false;
+    }
+
+    memset(&_header, 0, sizeof(SessionHeader));
+    memcpy(_header.magic, Session::_magic, sizeof(Session::_magic));
+    _header.version = Session::_version;
+    _header.thumbnailMode = prefs._thumbnails;
+    _header.hashAlgorithm = prefs._hashAlgorithm;
+    _header.frames = static_cast<uint32_t>(Thumbnail(prefs._thumbnails).percentages().count());
+    _queryVideos = queryVideos;
+    _file.seek(sizeof(SessionHeader));          //blobs are written as videos come, records after them last
+    return true;
+}
+
+uint32_t SessionWriter::intern(const QString &text)
+{
+    if(!_interned.contains(text))
+    {
+        _interned.insert(text, static_cast<uint32_t>(_strings.size()));
+        _strings.append(text.toUtf8()).append('\0');
+    }
+    return _interned.value(text);
+}
+
+void SessionWriter::add(const Video &video, const QString &filename)
+{
+    if(!_file.isOpen())
+        return;
+
+    const QString &path = filename.isEmpty()? video.filename : filename;
+    const QFileInfo file(path);
+    SessionRecord record;
+    memset(&record, 0, sizeof(SessionRecord));
+    record.size = video.size;
+    record.duration = video.duration;
+    record.modified = filename.isEmpty()? video.modified.toMSecsSinceEpoch() : file.lastModified().toMSecsSinceEpoch();
+    record.framerate = video.framerate;
+    record.bitrate = video.bitrate;
+    record.width = video.width;
+    record.height = video.height;
+    record.directory = intern(file.path());
+    record.name = static_cast<uint32_t>(_strings.size());     //unique for each video, not worth looking up
+    _strings.append(file.fileName().toUtf8()).append('\0');
+    record.codec = intern(video.codec);
+    record.audio = intern(video.audio);
+    record.query = _queryVideos.contains(path)? 1 : 0;
+    _header.queries += record.query;
+    record.hash[0] = video.hash[0];
+    record.hash[1] = video.hash[1];
+
+    record.thumbnail = _blobs;
+    record.thumbnailLength = static_cast<uint32_t>(video.thumbnail.size());
+    _blobs += static_cast<uint64_t>(_file.write(video.thumbnail));
+
+    const int graySize = Video::_ssimSize * Video::_ssimSize;
+    record.grayThumbs = _blobs;
+    for(const auto &grayThumb : video.grayThumb)        //stored as 8 bit, that's what they were made from
+    {
+        cv::Mat gray = cv::Mat::zeros(Video::_ssimSize, Video::_ssimSize, CV_8U);
+        if(!grayThumb.empty())
+            grayThumb.convertTo(gray, CV_8U);
+        _blobs += static_cast<uint64_t>(_file.write(reinterpret_cast<const char *>(gray.data), graySize));
+    }
+
+    const int padding = static_cast<int>((sizeof(uint64_t) - _blobs % sizeof(uint64_t)) % sizeof(uint64_t));
+    _blobs += static_cast<uint64_t>(_file.write(QByteArray(padding, '\0')));    //aligned for reading in place
+    record.frameHashes = _blobs;
+    for(uint32_t frame=0; frame<_header.frames; frame++)
+    {
+        const Fingerprint frameHash = static_cast<int>(frame) < video.frameHash.count()? video.frameHash[frame] :
+                                                                                         Fingerprint();
+        _blobs += static_cast<uint64_t>(_file.write(reinterpret_cast<const char *>(&frameHash), sizeof(Fingerprint)));
+    }
+
+    record.audioPrints = _blobs;
+    record.audioPrintCount = static_cast<uint32_t>(video.audioPrint.count());
+    _blobs += static_cast<uint64_t>(_file.write(reinterpret_cast<const char *>(video.audioPrint.constData()),
+                                    video.audioPrint.count() * static_cast<qint64>(sizeof(uint32_t))));
+    _records << record;
+}
+
+bool SessionWriter::finish(Session &session, const QString &folders, const QString &queryFolders)
+{
+    if(!_file.isOpen())
+        return false;
+
+    const int padding = static_cast<int>((sizeof(uint64_t) - _blobs % sizeof(uint64_t)) % sizeof(uint64_t));
+    _blobs += static_cast<uint64_t>(_file.write(QByteArray(padding, '\0')));    //records are read in place too
+    const qint64 recordsSize = static_cast<qint64>(_records.count()) * static_cast<qint64>(sizeof(SessionRecord));
+    _file.write(reinterpret_cast<const char *>(_records.constData()), recordsSize);
+    _header.count = static_cast<uint32_t>(_records.count());
+    _header.folders = intern(folders);
+    _header.queryFolders = intern(queryFolders);
+    _file.write(_strings);
+
+    _header.blobs = sizeof(SessionHeader);
+    _header.records = _header.blobs + _blobs;
+    _header.strings = _header.records + static_cast<uint64_t>(recordsSize);
+    _header.fileSize = _header.strings + static_cast<uint64_t>(_strings.size());
+    _file.seek(0);
+    _file.write(reinterpret_cast<const char *>(&_header), sizeof(SessionHeader));
+    const bool written = _file.error() == QFile::NoError;
+    const QString temporaryName = _file.fileName();
+    _file.close();
+    _records = QVector<SessionRecord>();
+    _strings = QByteArray();
+    _interned.clear();
+    _queryVideos.clear();
+    _blobs = 0;
+
+    if(written && session.load(temporaryName))
+    {
+        session._temporaryName = temporaryName;
+        return true;
+    }
+    QFile::remove(temporaryName);
+    return false;
+}
+
+void SessionWriter::discard()
+{
+    if(!_file.isOpen())
+        return;
+    _file.close();
+    QFile::remove(_file.fileName());
+    _records = QVector<SessionRecord>();
+    _strings = QByteArray();
+    _interned.clear();
+    _queryVideos.clear();
+    _blobs = 0;
+}
+
+bool Session::load(const QString &filename)
+{
+    close();
+
+    _file.setFileName(filename);
+    if(!_file.open(QIODevice::ReadOnly) || _file.size() < static_cast<qint64>(sizeof(SessionHeader)))
+    {
+        close();
+        return false;
+    }
+    const uchar *data = _file.map(0, _file.size());
+    if(!data)
+    {
+        close();
+        return false;
+    }
+
+    const SessionHeader *header = reinterpret_cast<const SessionHeader *>(data);
+    if(memcmp(header->magic, _magic, sizeof(_magic)) != 0 || header->version != _version ||
+       header->fileSize != static_cast<uint64_t>(_file.size()) || header->strings > header->fileSize ||
+       header->blobs > header->records ||
+       header->records + static_cast<uint64_t>(header->count) * sizeof(SessionRecord) != header->strings ||
+       !validRecords(data))
+    {
+        _file.unmap(const_cast<uchar *>(data));
+        close();
+        return false;
+    }
+
+    attach(data);
+    return true;
+}
+
+bool Session::validRecords(const uchar *data)
+{                                               //offsets are used without checks later, broken file must not crash
+    const SessionHeader *header = reinterpret_cast<const SessionHeader *>(data);
+    const uint64_t blobsSize = header->records - header->blobs;
+    const uint64_t stringsSize = header->fileSize - header->strings;
+    if(header->blobs % sizeof(uint64_t) || header->records % sizeof(uint64_t) || stringsSize == 0 ||
+       data[header->fileSize - 1] != '\0' || header->folders >= stringsSize || header->queryFolders >= stringsSize)
+        return false;                           //string table ending in NUL ends every string inside of it
+
+    auto withinBlobs = [&blobsSize](const uint64_t &offset, const uint64_t &length)
+        { return offset <= blobsSize && length <= blobsSize - offset; };
+    const uint64_t grayThumbsSize = sizeof(Video::grayThumb) / sizeof(Video::grayThumb[0]) *
+                                    static_cast<uint64_t>(Video::_ssimSize * Video::_ssimSize);
+    const SessionRecord *records = reinterpret_cast<const SessionRecord *>(data + header->records);
+    for(uint32_t video=0; video<header->count; video++)
+    {
+        const SessionRecord &record = records[video];
+        if(!withinBlobs(record.thumbnail, record.thumbnailLength) ||
+           !withinBlobs(record.grayThumbs, grayThumbsSize) ||
+           !withinBlobs(record.frameHashes, static_cast<uint64_t>(header->frames) * sizeof(Fingerprint)) ||
+           !withinBlobs(record.audioPrints, static_cast<uint64_t>(record.audioPrintCount) * sizeof(uint32_t)) ||
+           record.frameHashes % sizeof(uint64_t) || record.audioPrints % sizeof(uint32_t) ||
+           record.directory >= stringsSize || record.name >= stringsSize ||
+           record.codec >= stringsSize || record.audio >= stringsSize)
+            return false;
+    }
+    return true;
+}
+
+bool Session::save(const QString &filename) const
+{
+    if(!_header)
+        return false;
+    QSaveFile file(filename);                   //written beside target and renamed over it when complete, saving over
+    if(!file.open(QIODevice::WriteOnly))        //the session file that is mapped must not truncate what is read
+        return false;
+
+    SessionHeader header = *_header;
+    QByteArray records(reinterpret_cast<const char *>(_records), count() * static_cast<int>(sizeof(SessionRecord)));
+    QByteArray strings(_strings, static_cast<int>(_header->fileSize - _header->strings));
+    for(auto renamed=_renamed.cbegin(); renamed!=_renamed.cend(); renamed++)
+    {                                           //renamed videos get new strings at the end, old ones stay unused
+        SessionRecord *record = reinterpret_cast<SessionRecord *>(records.data()) + renamed.key();
+        const QFileInfo file(renamed.value());
+        record->directory = static_cast<uint32_t>(strings.size());
+        strings.append(file.path().toUtf8()).append('\0');
+        record->name = static_cast<uint32_t>(strings.size());
+        strings.append(file.fileName().toUtf8()).append('\0');
+    }
+    header.fileSize = header.strings + static_cast<uint64_t>(strings.size());
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(SessionHeader));
+    file.write(reinterpret_cast<const char *>(_data + _header->blobs), static_cast<qint64>(_header->records - _header->blobs));
+    file.write(records);
+    file.write(strings);
+    return file.commit();
+}
+
+void Session::close()
+{
+    if(_file.isOpen())
+    {
+        if(_data)
+            _file.unmap(const_cast<uchar *>(_data));
+        _file.close();
+    }
+    if(!_temporaryName.isEmpty())
+        QFile::remove(_temporaryName);
+    _temporaryName.clear();
+    _renamed.clear();
+    _candidates.clear();
+    _data = nullptr;
+    _header = nullptr;
+    _records = nullptr;
+    _strings = nullptr;
+}
+
+void Session::attach(const uchar *data)
+{
+    _data = data;
+    _header = reinterpret_cast<const SessionHeader *>(data);
+    _records = reinterpret_cast<const SessionRecord *>(data + _header->records);
+    _strings = reinterpret_cast<const char *>(data + _header->strings);
+}
+
+QString Session::filename(const int &video) const
+{
+    if(_renamed.contains(video))
+        return _renamed.value(video);
+    return QStringLiteral("%1/%2").arg(string(_records[video].directory), string(_records[video].name));
+}
+
+QByteArray Session::thumbnail(const int &video) const
+{
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(_data + _header->blobs + _records[video].thumbnail),
+                                   static_cast<int>(_records[video].thumbnailLength));
+}
+
+const Fingerprint &Session::frameHash(const int &video, const int &frame) const
+{
+    return reinterpret_cast<const Fingerprint *>(_data + _header->blobs + _records[video].frameHashes)[frame];
+}
+
+const uint32_t *Session::audioPrints(const int &video) const
+{
+    return reinterpret_cast<const uint32_t *>(_data + _header->blobs + _records[video].audioPrints);
+}
+
+cv::Mat Session::grayThumb(const int &video, const int &nthHash) const
+{
+    const int graySize = Video::_ssimSize * Video::_ssimSize;
+    const uchar *pixels = _data + _header->blobs + _records[video].grayThumbs + nthHash * graySize;
+    cv::Mat gray;
+    cv::Mat(Video::_ssimSize, Video::_ssimSize, CV_8U, const_cast<uchar *>(pixels)).convertTo(gray, CV_32F);
+    return gray;
+}
@@ -0,0 +1,179 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QDateTime>
+#include <opencv2/core/core.hpp>
+#include "prefs.h"
+#include "hasher.h"
+#include "candidates.h"
+
+class Video;
+
+//a finished search: every video as fixed size record, followed by thumbnails and strings. a session is always
+//written to disk and memory-mapped, so a saved session is compared straight from file when opened again
+//
+//  SessionHeader | thumbnails, SSIM images, frame fingerprints and audio | SessionRecord[count] | strings (UTF-8, NUL terminated, no duplicates)
+
+struct SessionHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    int32_t thumbnailMode;
+    int32_t hashAlgorithm;
+    uint32_t folders;                   //offset in strings
+    uint32_t frames;                    //screen captures of thumbnail mode, each has its own fingerprint
+    uint32_t queryFolders;              //offset in strings, empty if not searched in query mode
+    uint32_t queries;                   //videos from query folders
+    uint64_t records;                   //offsets from beginning of file
+    uint64_t blobs;
+    uint64_t strings;
+    uint64_t fileSize;
+};
+
+struct SessionRecord
+{
+    int64_t size;
+    int64_t duration;
+    int64_t modified;                   //milliseconds since epoch
+    double framerate;
+    int32_t bitrate;
+    int16_t width;
+    int16_t height;
+    uint32_t directory;                 //offsets in strings
+    uint32_t name;
+    uint32_t codec;
+    uint32_t audio;
+    uint64_t thumbnail;                 //offsets in blobs
+    uint64_t grayThumbs;
+    uint64_t audioPrints;
+    uint64_t frameHashes;
+    uint32_t thumbnailLength;
+    uint32_t audioPrintCount;
+    uint32_t query;                     //1 if from query folders
+    uint32_t reserved;
+    Fingerprint hash[2];
+};
+
+static_assert(sizeof(SessionHeader) == 72, "session file layout changed");
+static_assert(sizeof(SessionRecord) == 168, "session file layout changed");
+
+class Session
+{
+    friend class SessionWriter;
+
+public:
+    Session() {}
+    ~Session() { close(); }
+
+private:
+    Q_DISABLE_COPY(Session)
+
+    QFile _file;
+    QString _temporaryName;             //session of a search just finished is in temp folder until closed
+    const uchar *_data = nullptr;
+    const SessionHeader *_header = nullptr;
+    const SessionRecord *_records = nullptr;
+    const char *_strings = nullptr;
+    QHash<int, QString> _renamed;       //filenames changed after session was created
+    Candidates _candidates;             //derived from fingerprints when comparing, not saved
+
+    static constexpr char _magic[8] = { 'V', 'I', 'D', 'U', 'P', 'E', 'S', 'S' };
+    static constexpr uint32_t _version = 5;
+
+    void attach(const uchar *data);
+    static bool validRecords(const uchar *data);
+    QString string(const uint32_t &offset) const { return QString::fromUtf8(_strings + offset); }
+
+public:
+    //memory-map a saved session, returns false if file is not a valid session
+    bool load(const QString &filename);
+
+    //write session to disk. an existing file, also the one this session was loaded from, is replaced only when
+    //the new one is complete
+    bool save(const QString &filename) const;
+
+    void close();
+
+    int count() const { return _header? static_cast<int>(_header->count) : 0; }
+    int thumbnailMode() const { return _header->thumbnailMode; }
+    int hashAlgorithm() const { return _header->hashAlgorithm; }
+    QString folders() const { return string(_header->folders); }
+    QString queryFolders() const { return string(_header->queryFolders); }
+    int queryCount() const { return static_cast<int>(_header->queries); }
+
+    QString filename(const int &video) const;
+    void setFilename(const int &video, const QString &filename) { _renamed.insert(video, filename); }
+    int64_t size(const int &video) const { return _records[video].size; }
+    int64_t duration(const int &video) const { return _records[video].duration; }
+    QDateTime modified(const int &video) const { return QDateTime::fromMSecsSinceEpoch(_records[video].modified); }
+    double framerate(const int &video) const { return _records[video].framerate; }
+    int bitrate(const int &video) const { return _records[video].bitrate; }
+    short width(const int &video) const { return _records[video].width; }
+    short height(const int &video) const { return _records[video].height; }
+    bool query(const int &video) const { return _records[video].query != 0; }
+    QString codec(const int &video) const { return string(_records[video].codec); }
+    QString audio(const int &video) const { return string(_records[video].audio); }
+    const Fingerprint &hash(const int &video, const int &nthHash) const { return _records[video].hash[nthHash]; }
+
+    //fingerprint of one screen capture alone, frames are in order of Thumbnail::percentages()
+    int frameCount() const { return static_cast<int>(_header->frames); }
+    const Fingerprint &frameHash(const int &video, const int &frame) const;
+
+    //JPEG of GUI thumbnail, not copied
+    QByteArray thumbnail(const int &video) const;
+
+    //16x16 image for SSIM comparison
+    cv::Mat grayThumb(const int &video, const int &nthHash) const;
+
+    //audio sub-fingerprints, not copied
+    const uint32_t *audioPrints(const int &video) const;
+    int audioPrintCount(const int &video) const { return static_cast<int>(_records[video].audioPrintCount); }
+
+    Candidates &candidates() { return _candidates; }
+};
+
+//builds a session in temp folder while videos are processed. thumbnails and fingerprints of each accepted video are
+//written right away, so the video can be deleted: only its record and strings not seen before stay in memory
+
+class SessionWriter
+{
+
+public:
+    SessionWriter() {}
+    ~SessionWriter() { discard(); }
+
+private:
+    Q_DISABLE_COPY(SessionWriter)
+
+    QFile _file;
+    SessionHeader _header;
+    QVector<SessionRecord> _records;
+    QByteArray _strings;
+    QHash<QString, uint32_t> _interned;         //directories, codecs and audio are same for many videos
+    uint64_t _blobs = 0;
+    QSet<QString> _queryVideos;
+
+    uint32_t intern(const QString &text);
+
+public:
+    //start new session. in query mode, videos of library folders are not compared with each other, only with those
+    //in queryVideos
+    bool begin(const Prefs &prefs, const QSet<QString> &queryVideos = QSet<QString>());
+
+    //write video to session, filename is given for a byte-identical copy of video
+    void add(const Video &video, const QString &filename = QString());
+
+    int count() const { return _records.count(); }
+
+    //write records and strings, then session is memory-mapped from file. writer can begin again after this
+    bool finish(Session &session, const QString &folders, const QString &queryFolders = QString());
+
+    //delete unfinished session
+    void discard();
+};
+
+#endif // SESSION_H
@@ -30,6 +30,9 @@ public:
     int cols() { return m_layout[m_mode][0]; }
     int rows() { return m_layout[m_mode][1]; }
     QVector<int> percentages() { return m_capturePos[m_mode]; }
+
+    //every mode captures a subset of these, merging and compacting the cache copy captures at these percentages
+    static QVector<int> allPercentages() { return { 8, 16, 24, 32, 40, 48, 56, 64, 72, 80, 88, 96 }; }
 };
 
 #endif // THUMBNAIL_H
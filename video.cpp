@@ -1,8 +1,12 @@
 #include <QPainter>
+#include <QImageReader>
 #include "video.h"
+#include "audioprint.h"
+#include "governor.h"
 
 Prefs Video::_prefs;
 int Video::_jpegQuality = _okJpegQuality;
+std::atomic<bool> Video::_aborted(false);
 
 Video::Video(const Prefs &prefsParam, const QString &filenameParam) : filename(filenameParam)
 {
@@ -10,13 +14,16 @@ Video::Video(const Prefs &prefsParam, const QString &filenameParam) : filename(f
     if(_prefs._numberOfVideos > _hugeAmountVideos)       //save memory to avoid crash due to 32 bit limit
         _jpegQuality = _lowJpegQuality;
 
+    if(!_prefs._mainwPtr)                               //worker mode connects to its own slots
+        return;
     QObject::connect(this, SIGNAL(rejectVideo(Video *)), _prefs._mainwPtr, SLOT(removeVideo(Video *)));
     QObject::connect(this, SIGNAL(acceptVideo(Video *)), _prefs._mainwPtr, SLOT(addVideo(Video *)));
 }
 
 void Video::run()
 {
-    if(!QFileInfo::exists(filename))
+    _elapsed.start();
+    if(!QFileInfo::exists(filename) || _aborted)
     {
         emit rejectVideo(this);
         return;
@@ -25,8 +32,8 @@ void Video::run()
     Db cache(filename);
     if(!cache.readMetadata(*this))      //check first if video properties are cached
     {
-        getMetadata(filename);          //if not, read them with ffmpeg
-        cache.writeMetadata(*this);
+        if(getMetadata(filename))       //if not, read them with ffmpeg
+            cache.writeMetadata(*this); //probe that was killed is not cached, can succeed next time
     }
     if(width == 0 || height == 0 || duration == 0)
     {
@@ -35,21 +42,54 @@ void Video::run()
     }
 
     const int ret = takeScreenCaptures(cache);
-    if(ret == _failure)
+    if(ret == _success && _prefs._audioFingerprint && !audio.isEmpty())
+        takeAudioPrints(cache);
+    if(ret == _failure || _aborted)
         emit rejectVideo(this);
-    else if((_prefs._thumbnails != cutEnds && hash[0] == 0 ) ||
-            (_prefs._thumbnails == cutEnds && hash[0] == 0 && hash[1] == 0))   //all screen captures black
+    else if((_prefs._thumbnails != cutEnds && hash[0].isNull()) ||
+            (_prefs._thumbnails == cutEnds && hash[0].isNull() && hash[1].isNull()))   //all screen captures black
         emit rejectVideo(this);
     else
         emit acceptVideo(this);
 }
 
-void Video::getMetadata(const QString &filename)
+void Video::loadFromCache()
+{
+    const Db cache(filename);                   //imported results are shown without running ffmpeg, so only
+    cache.readMetadata(*this);                  //cached metadata and screen captures are available
+    const QFileInfo videoFile(filename);
+    size = videoFile.size();
+    modified = videoFile.lastModified();
+
+    Thumbnail thumb(_prefs._thumbnails);
+    const QSize tile = tileSize();
+    QImage thumbnail(thumb.cols() * tile.width(), thumb.rows() * tile.height(), QImage::Format_RGB888);
+    thumbnail.fill(Qt::black);
+
+    QPainter painter(&thumbnail);
+    const QVector<int> percentages = thumb.percentages();
+    for(int capture=0; capture<percentages.count(); capture++)
+    {
+        QByteArray cachedImage = cache.readCapture(percentages[capture]);
+        const QImage frame = cachedImage.isNull()? QImage() : decodeCapture(cachedImage, tile);
+        if(frame.isNull())
+            continue;                           //capture missing from cache stays black
+        painter.drawImage(capture % thumb.cols() * tile.width(), capture / thumb.cols() * tile.height(), frame);
+    }
+    painter.end();
+
+    thumbnail = minimizeImage(thumbnail);
+    QBuffer buffer(&this->thumbnail);
+    thumbnail.save(&buffer, QByteArrayLiteral("JPG"), _jpegQuality);
+}
+
+bool Video::getMetadata(const QString &filename)
 {
     QProcess probe;
     probe.setProcessChannelMode(QProcess::MergedChannels);
     probe.start(QStringLiteral("ffmpeg -hide_banner -i \"%1\"").arg(QDir::toNativeSeparators(filename)));
-    probe.waitForFinished();
+    if(!waitForProcess(probe, timeLeft()))
+        return false;
 
     bool rotatedOnce = false;
     const QString analysis(probe.readAllStandardOutput());
@@ -117,55 +157,58 @@ void Video::getMetadata(const QString &filename)
     const QFileInfo videoFile(filename);
     size = videoFile.size();
     modified = videoFile.lastModified();
+    return true;
 }
 
 int Video::takeScreenCaptures(const Db &cache)
 {
     Thumbnail thumb(_prefs._thumbnails);
-    QImage thumbnail(thumb.cols() * width, thumb.rows() * height, QImage::Format_RGB888);
+    const QSize tile = tileSize();          //frames are scaled down before composing, full size mosaic of 4K is huge
+    QImage thumbnail(thumb.cols() * tile.width(), thumb.rows() * tile.height(), QImage::Format_RGB888);
     const QVector<int> percentages = thumb.percentages();
-    int capture = percentages.count();
-    int ofDuration = 100;
+    frameHash.fill(Fingerprint(), percentages.count());
 
-    while(--capture >= 0)           //screen captures are taken in reverse order so errors are found early
+    for(int capture=percentages.count()-1; capture>=0; capture--)  //reverse order so errors are found early
     {
+        if(_aborted || timeLeft() == 0)
+            return _failure;
+
         QImage frame;
         QByteArray cachedImage = cache.readCapture(percentages[capture]);
-        QBuffer captureBuffer(&cachedImage);
-        bool writeToCache = false;
+        if(!cachedImage.isNull())   //image was already in cache, stored small so decoded right at tile size
+            frame = decodeCapture(cachedImage, tile);
 
-        if(!cachedImage.isNull())   //image was already in cache
-        {
-            frame.load(&captureBuffer, QByteArrayLiteral("JPG"));   //was saved in cache as small size, resize to original
-            frame = frame.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        }
-        else
+        const bool captured = frame.isNull();
+        if(captured)
         {
-            frame = captureAt(percentages[capture], ofDuration);
-            if(frame.isNull())                                  //taking screen capture may fail if video is broken
-            {
+            int ofDuration = 100;
+            frame = captureScaledAt(percentages[capture], ofDuration, tile);
+            while(frame.isNull())                               //taking screen capture may fail if video is broken
+            {                                                   //retry only this one, always closer to beginning
                 ofDuration = ofDuration - _goBackwardsPercent;
-                if(ofDuration >= _videoStillUsable)             //retry a few times, always closer to beginning
-                {
-                    capture = percentages.count();
-                    continue;
-                }
-                return _failure;
+                if(ofDuration < _videoStillUsable || _aborted || timeLeft() == 0)
+                    return _failure;
+                frame = captureScaledAt(percentages[capture], ofDuration, tile);
             }
-            writeToCache = true;
-        }
-        if(frame.width() > width || frame.height() > height)    //metadata parsing error or variable resolution
-            return _failure;
 
-        QPainter painter(&thumbnail);                           //copy captured frame into right place in thumbnail
-        painter.drawImage(capture % thumb.cols() * width, capture / thumb.cols() * height, frame);
+            if(!_prefs._grayCaptures)                           //colour runs would show gray captures of cache
+            {
+                cachedImage.clear();
+                QBuffer captureBuffer(&cachedImage);
+                frame.save(&captureBuffer, QByteArrayLiteral("JPG"), _okJpegQuality);
+                cache.writeCapture(percentages[capture], cachedImage,   //cached right away, kept if a later one fails
+                                   capturePosition(duration, percentages[capture], ofDuration));
+            }
+        }
 
-        if(writeToCache)
-        {
-            frame = minimizeImage(frame);
-            frame.save(&captureBuffer, QByteArrayLiteral("JPG"), _okJpegQuality);
-            cache.writeCapture(percentages[capture], cachedImage);
+        if(captured || !cache.readFrameHash(percentages[capture], _prefs._hashAlgorithm, frameHash[capture]))
+        {                                                       //same for every thumbnail mode using this capture
+            frameHash[capture] = hashOfFrame(frame);
+            cache.writeFrameHash(percentages[capture], _prefs._hashAlgorithm, frameHash[capture]);
         }
+
+        QPainter painter(&thumbnail);                           //copy captured frame into right place in thumbnail
+        painter.drawImage(capture % thumb.cols() * tile.width(), capture / thumb.cols() * tile.height(), frame);
     }
 
     const int hashes = _prefs._thumbnails == cutEnds? 2 : 1;    //if cutEnds mode: separate hash for beginning and end
@@ -173,6 +216,69 @@ int Video::takeScreenCaptures(const Db &cache)
     return _success;
 }
 
+void Video::takeAudioPrints(const Db &cache)
+{
+    const QVector<int> percentages = Thumbnail(_prefs._thumbnails).percentages();
+    for(const auto &percent : percentages)
+    {
+        if(_aborted || timeLeft() == 0)
+            return;
+        QByteArray prints = cache.readAudio(percent);
+        if(prints.isNull())
+        {
+            QByteArray samples;
+            if(!decodeAudioAt(percent, samples))
+                return;                                 //killed ffmpeg, nothing is cached
+            const QVector<uint32_t> computed = AudioPrint::compute(samples);
+            prints = QByteArray(reinterpret_cast<const char *>(computed.constData()),
+                                computed.count() * static_cast<int>(sizeof(uint32_t)));
+            cache.writeAudio(percent, prints);
+        }
+        const int previous = audioPrint.count();
+        audioPrint.resize(previous + prints.size() / static_cast<int>(sizeof(uint32_t)));
+        memcpy(audioPrint.data() + previous, prints.constData(), (audioPrint.count() - previous) * sizeof(uint32_t));
+    }
+}
+
+QImage Video::captureScaledAt(const int &percent, const int &ofDuration, const QSize &size) const
+{                                               //ffmpeg scales while decoding and pipes raw pixels, no full size frame
+    const bool gray = _prefs._grayCaptures;     //is written, converted or read
+    QProcess ffmpeg;
+    const QString ffmpegCommand = QStringLiteral("ffmpeg -hide_banner -loglevel error -threads %1 -ss %2 -i \"%3\" -an "
+                                                 "-frames:v 1 -vf scale=%4:%5 -pix_fmt %6 -f rawvideo -")
+                                  .arg(Governor::ffmpegThreads())
+                                  .arg(msToHHMMSS(capturePosition(duration, percent, ofDuration)),
+                                       QDir::toNativeSeparators(filename))
+                                  .arg(size.width()).arg(size.height())
+                                  .arg(gray? QStringLiteral("gray") : QStringLiteral("rgb24"));
+    ffmpeg.start(ffmpegCommand);
+    if(!waitForProcess(ffmpeg, qMin(timeLeft(), static_cast<int>(_captureTimeout))))
+        return QImage();
+
+    const int bytesPerPixel = gray? 1 : 3;
+    const QByteArray pixels = ffmpeg.readAllStandardOutput();
+    if(pixels.size() != size.width() * size.height() * bytesPerPixel)
+        return QImage();                        //broken video gives no frame or only part of it
+    const QImage frame(reinterpret_cast<const uchar *>(pixels.constData()), size.width(), size.height(),
+                       size.width() * bytesPerPixel, gray? QImage::Format_Grayscale8 : QImage::Format_RGB888);
+    return gray? frame.convertToFormat(QImage::Format_RGB888) : frame.copy();  //pixels are freed on return
+}
+
+bool Video::decodeAudioAt(const int &percent, QByteArray &samples) const
+{
+    QProcess ffmpeg;
+    const QString ffmpegCommand = QStringLiteral("ffmpeg -hide_banner -loglevel error -threads %1 -ss %2 -i \"%3\" -t %4 "
+                                                 "-vn -ac 1 -ar %5 -f s16le -")
+                                  .arg(Governor::ffmpegThreads())
+                                  .arg(msToHHMMSS(duration * percent / 100), QDir::toNativeSeparators(filename))
+                                  .arg(AudioPrint::_seconds).arg(AudioPrint::_sampleRate);
+    ffmpeg.start(ffmpegCommand);
+    if(!waitForProcess(ffmpeg, qMin(timeLeft(), static_cast<int>(_captureTimeout))))
+        return false;
+    samples = ffmpeg.readAllStandardOutput();   //raw samples, nothing if video has no audio
+    return true;
+}
+
 void Video::processThumbnail(QImage &thumbnail, const int &hashes)
 {
     for(int hash=0; hash<hashes; hash++)
@@ -182,7 +288,7 @@ void Video::processThumbnail(QImage &thumbnail, const int &hashes)
             image = thumbnail.copy(hash*thumbnail.width()/2, 0, thumbnail.width()/2, thumbnail.height());
 
         cv::Mat mat = cv::Mat(image.height(), image.width(), CV_8UC3, image.bits(), static_cast<uint>(image.bytesPerLine()));
-        this->hash[hash] = computePhash(mat);                           //pHash
+        this->hash[hash] = computeHash(mat);                            //pHash (or other selected hash)
 
         cv::resize(mat, mat, cv::Size(_ssimSize, _ssimSize), 0, 0, cv::INTER_AREA);
         cv::cvtColor(mat, grayThumb[hash], cv::COLOR_BGR2GRAY);
@@ -194,37 +300,53 @@ void Video::processThumbnail(QImage &thumbnail, const int &hashes)
     thumbnail.save(&buffer, QByteArrayLiteral("JPG"), _jpegQuality);    //save GUI thumbnail as tiny JPEG
 }
 
-uint64_t Video::computePhash(const cv::Mat &input) const
+Fingerprint Video::computeHash(const cv::Mat &input) const
 {
-    cv::Mat resizeImg, grayImg, grayFImg, dctImg, topLeftDCT;
-    cv::resize(input, resizeImg, cv::Size(_pHashSize, _pHashSize), 0, 0, cv::INTER_AREA);
-    cv::cvtColor(resizeImg, grayImg, cv::COLOR_BGR2GRAY);           //resize image to 32x32 grayscale
+    const cv::Mat grayImg = grayResized(input, _monochromeSize, _monochromeSize);
 
     int shadesOfGray = 0;
-    uchar* pixel = reinterpret_cast<uchar*>(grayImg.data);          //pointer to pixel values, starts at first one
-    const uchar* lastPixel = pixel + _pHashSize * _pHashSize;
+    const uchar* pixel = grayImg.data;                              //pointer to pixel values, starts at first one
+    const uchar* lastPixel = pixel + _monochromeSize * _monochromeSize;
     const uchar firstPixel = *pixel;
 
     for(pixel++; pixel<lastPixel; pixel++)              //skip first element since that one is already firstPixel
         shadesOfGray += qAbs(firstPixel - *pixel);      //compare all pixels with first one, tabulate differences
     if(shadesOfGray < _almostBlackBitmap)
-        return 0;                                       //reject video if capture was (almost) monochrome
+        return Fingerprint();                           //reject video if capture was (almost) monochrome
 
-    grayImg.convertTo(grayFImg, CV_32F);
-    cv::dct(grayFImg, dctImg);                          //compute DCT (discrete cosine transform)
-    dctImg(cv::Rect(0, 0, 8, 8)).copyTo(topLeftDCT);    //use only upper left 8*8 transforms (most significant ones)
+    switch(_prefs._hashAlgorithm)
+    {
+        case Prefs::_DIFFERENCE: return DifferenceHash::compute(input);
+        case Prefs::_AVERAGE:    return AverageHash::compute(input);
+        case Prefs::_WAVELET:    return WaveletHash::compute(input);
+        case Prefs::_DCT256:     return WidePerceptualHash::compute(input);
+        default:                 return PerceptualHash::compute(input);
+    }
+}
 
-    const float firstElement = *reinterpret_cast<float*>(topLeftDCT.data);      //compute avg but skip first element
-    const float average = (static_cast<float>(cv::sum(topLeftDCT)[0]) - firstElement) / 63;         //(it's very big)
+Fingerprint Video::hashOfFrame(const QImage &frame) const
+{
+    QImage image = frame.convertToFormat(QImage::Format_RGB888);
+    const cv::Mat mat(image.height(), image.width(), CV_8UC3, image.bits(), static_cast<uint>(image.bytesPerLine()));
+    return computeHash(mat);
+}
 
-    uint64_t hash = 0;
-    float* transform = reinterpret_cast<float*>(topLeftDCT.data);
-    const float* endOfData = transform + 64;
-    for(int i=0; transform<endOfData; i++, transform++)             //construct hash from all 8x8 bits
-        if(*transform > average)
-            hash |= 1ULL << i;                                      //larger than avg = 1, smaller than avg = 0
+QImage Video::decodeCapture(QByteArray &jpeg, const QSize &size)
+{                                           //JPEG decoder scales while decoding, no image of stored size in between
+    QBuffer buffer(&jpeg);
+    QImageReader reader(&buffer, QByteArrayLiteral("JPG"));
+    reader.setScaledSize(size);
+    return reader.read();
+}
 
-    return hash;
+QSize Video::tileSize() const
+{                                           //size of one capture in thumbnail, smaller than video if that is large
+    if(width <= 0 || height <= 0)
+        return QSize(_thumbnailMaxWidth, _thumbnailMaxHeight);
+    const QSize video(width, height);
+    if(width <= _thumbnailMaxWidth && height <= _thumbnailMaxHeight)
+        return video;
+    return video.scaled(_thumbnailMaxWidth, _thumbnailMaxHeight, Qt::KeepAspectRatio);
 }
 
 QImage Video::minimizeImage(const QImage &image) const
@@ -240,7 +362,26 @@ QImage Video::minimizeImage(const QImage &image) const
     return image;
 }
 
-QString Video::msToHHMMSS(const int64_t &time) const
+bool Video::waitForProcess(QProcess &process, const int &timeout, const std::atomic<bool> *cancelled)
+{                                               //hung ffmpeg is killed when out of time, stop was pressed or cancelled
+    const std::atomic<bool> &stop = cancelled? *cancelled : _aborted;   //own flag replaces stop button
+    QElapsedTimer elapsed;
+    elapsed.start();
+    while(!process.waitForFinished(_processPollTime))
+    {
+        if(process.state() == QProcess::NotRunning)     //could not be started
+            return false;
+        if(stop || elapsed.elapsed() >= timeout)
+        {
+            process.kill();
+            process.waitForFinished();
+            return false;
+        }
+    }
+    return process.exitStatus() == QProcess::NormalExit;
+}
+
+QString Video::msToHHMMSS(const int64_t &time)
 {
     const int hours   = time / (1000*60*60) % 24;
     const int minutes = time / (1000*60) % 60;
@@ -262,7 +403,8 @@ QString Video::msToHHMMSS(const int64_t &time) const
     return QStringLiteral("%1:%2:%3.%4").arg(paddedHours, paddedMinutes, paddedSeconds).arg(msecs);
 }
 
-QImage Video::captureAt(const int &percent, const int &ofDuration) const
+QImage Video::captureAt(const QString &filename, const int64_t &duration, const int &percent, const int &ofDuration,
+                        const std::atomic<bool> *cancelled, const int &timeout)
 {
     const QTemporaryDir tempDir;
     if(!tempDir.isValid())
@@ -271,10 +413,11 @@ QImage Video::captureAt(const int &percent, const int &ofDuration) const
     const QString screenshot = QStringLiteral("%1/vidupe%2.bmp").arg(tempDir.path()).arg(percent);
     QProcess ffmpeg;
     const QString ffmpegCommand = QStringLiteral("ffmpeg -ss %1 -i \"%2\" -an -frames:v 1 -pix_fmt rgb24 %3")
-                                  .arg(msToHHMMSS(duration * (percent * ofDuration) / (100 * 100)),
+                                  .arg(msToHHMMSS(capturePosition(duration, percent, ofDuration)),
                                   QDir::toNativeSeparators(filename), QDir::toNativeSeparators(screenshot));
     ffmpeg.start(ffmpegCommand);
-    ffmpeg.waitForFinished(10000);
+    if(!waitForProcess(ffmpeg, timeout, cancelled))
+        return QImage();                        //frame of killed process may be incomplete
 
     const QImage img(screenshot, "BMP");
     QFile::remove(screenshot);
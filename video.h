@@ -6,17 +6,23 @@
 #include <QProcess>
 #include <QBuffer>
 #include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <atomic>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "prefs.h"
+#include "hasher.h"
 #include "db.h"
 
 class Video : public QObject, public QRunnable
 {
     Q_OBJECT
+    friend class Session;
+    friend class SessionWriter;
 
 public:
     Video(const Prefs &prefsParam, const QString &filenameParam);
     void run();
+    void loadFromCache();
 
     QString filename;
     int64_t size = 0;
@@ -30,18 +36,36 @@ public:
     short height = 0;
     QByteArray thumbnail;
     cv::Mat grayThumb [2];
-    uint64_t hash [2] = { 0, 0 };
+    Fingerprint hash [2];
+    QVector<Fingerprint> frameHash;     //each screen capture on its own, in order of Thumbnail::percentages()
+    QVector<uint32_t> audioPrint;       //sub-fingerprints of all capture points, empty if not taken
 
 private slots:
-    void getMetadata(const QString &filename);
+    bool getMetadata(const QString &filename);
     int takeScreenCaptures(const Db &cache);
+    void takeAudioPrints(const Db &cache);
+    QImage captureScaledAt(const int &percent, const int &ofDuration, const QSize &size) const;
+    bool decodeAudioAt(const int &percent, QByteArray &samples) const;
     void processThumbnail(QImage &thumbnail, const int &hashes);
-    uint64_t computePhash(const cv::Mat &input) const;
+    Fingerprint computeHash(const cv::Mat &input) const;
+    Fingerprint hashOfFrame(const QImage &frame) const;
     QImage minimizeImage(const QImage &image) const;
-    QString msToHHMMSS(const int64_t &time) const;
+    QSize tileSize() const;
+    static QImage decodeCapture(QByteArray &jpeg, const QSize &size);
 
-public slots:
-    QImage captureAt(const int &percent, const int &ofDuration=100) const;
+public:
+    //full resolution capture outside of processing. ffmpeg is killed if cancelled becomes true, not on stop
+    static QImage captureAt(const QString &filename, const int64_t &duration, const int &percent, const int &ofDuration=100,
+                            const std::atomic<bool> *cancelled=nullptr, const int &timeout=_captureTimeout);
+
+    //user pressed stop: running ffmpeg processes are killed and unfinished videos rejected until set false again
+    static void abortProcessing(const bool &abort) { _aborted = abort; }
+    static bool aborted() { return _aborted; }
+    static QString msToHHMMSS(const int64_t &time);
+
+    //milliseconds from beginning where capture at percent of first ofDuration percent of video is taken
+    static int64_t capturePosition(const int64_t &duration, const int &percent, const int &ofDuration=100)
+        { return duration * (percent * ofDuration) / (100 * 100); }
 
 signals:
     void acceptVideo(Video *addMe) const;
@@ -50,17 +74,26 @@ signals:
 private:
     static Prefs _prefs;
     static int _jpegQuality;
+    static std::atomic<bool> _aborted;
+
+    QElapsedTimer _elapsed;                             //started when processing of video begins
+
+    int timeLeft() const { return qMax(0, _fileTimeBudget - static_cast<int>(_elapsed.elapsed())); }
+    static bool waitForProcess(QProcess &process, const int &timeout, const std::atomic<bool> *cancelled=nullptr);
 
     enum _returnValues { _success, _failure };
 
     static constexpr int _okJpegQuality      = 60;
     static constexpr int _lowJpegQuality     = 25;
     static constexpr int _hugeAmountVideos   = 200000;
+    static constexpr int _fileTimeBudget     = 120000;  //ms for probing and all captures of one video, then rejected
+    static constexpr int _captureTimeout     = 10000;   //ms for one ffmpeg run, hung process is killed after this
+    static constexpr int _processPollTime    = 100;     //ms between checks for stop and timeout
     static constexpr int _goBackwardsPercent = 6;       //if capture fails, retry but omit this much from end
     static constexpr int _videoStillUsable   = 90;      //90% of video duration is considered usable
     static constexpr int _thumbnailMaxWidth  = 448;     //small size to save memory and cache space
     static constexpr int _thumbnailMaxHeight = 336;
-    static constexpr int _pHashSize          = 32;      //phash generated from 32x32 image
+    static constexpr int _monochromeSize     = 32;      //monochrome check done on 32x32 image
     static constexpr int _ssimSize           = 16;      //larger than 16x16 seems to have slower comparison
     static constexpr int _almostBlackBitmap  = 1500;    //monochrome thumbnail if less shades of gray than this
 };
@@ -14,19 +14,43 @@ HEADERS += \
     prefs.h \
     video.h \
     thumbnail.h \
+    hasher.h \
+    candidates.h \
+    audioprint.h \
     db.h \
-    comparison.h
+    comparison.h \
+    groupview.h \
+    matchfile.h \
+    session.h \
+    worker.h \
+    governor.h \
+    watcher.h \
+    exactcopies.h \
+    pack.h \
+    resolver.h
 
 SOURCES += \
     mainwindow.cpp \
     video.cpp \
     db.cpp \
     comparison.cpp \
-    ssim.cpp
+    groupview.cpp \
+    candidates.cpp \
+    audioprint.cpp \
+    matchfile.cpp \
+    session.cpp \
+    ssim.cpp \
+    worker.cpp \
+    governor.cpp \
+    watcher.cpp \
+    exactcopies.cpp \
+    pack.cpp \
+    resolver.cpp
 
 FORMS += \
     mainwindow.ui \
-    comparison.ui
+    comparison.ui \
+    groupview.ui
 
 LIBS += \
     $$PWD/bin/libopencv_core347.dll \
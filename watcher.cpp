@@ -0,0 +1,203 @@
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QTextStream>
+#include "watcher.h"
+#include "governor.h"
+#include "candidates.h"
+
+constexpr int Watcher::_settleTime;
+
+Watcher::Watcher(const Prefs &prefsParam, const QStringList &foldersParam, const QString &matchFileParam) :
+    _prefs(prefsParam), _folders(foldersParam), _matchFile(matchFileParam), _writeMatches(!matchFileParam.isEmpty())
+{
+    _prefs._mainwPtr = nullptr;
+    _threadPool.setMaxThreadCount(Governor().workers());
+    connect(&_watcher, SIGNAL(directoryChanged(const QString &)), this, SLOT(folderChanged(const QString &)));
+    connect(&_settleTimer, SIGNAL(timeout()), this, SLOT(checkArriving()));
+}
+
+void Watcher::print(const QString &line) const
+{                                               //written right away, output is often followed live
+    QTextStream out(stdout);
+    out << line << '\n';
+}
+
+void Watcher::loadExtensions()
+{                                               //same file as main window uses
+    QFile file(QStringLiteral("%1/extensions.ini").arg(QCoreApplication::applicationDirPath()));
+    if(!file.open(QIODevice::ReadOnly))
+        return;
+    QTextStream text(&file);
+    while(!text.atEnd())
+    {
+        QString line = text.readLine();
+        if(!line.startsWith(QStringLiteral(";")) && !line.isEmpty())
+            _extensions << line.replace(QRegExp("\\*?\\."), "*.").split(QStringLiteral(" "));
+    }
+}
+
+bool Watcher::start()
+{
+    loadExtensions();
+    if(_extensions.isEmpty())
+    {
+        print(QStringLiteral("Error: No extensions found in extensions.ini"));
+        return false;
+    }
+    if(_writeMatches && !_matchFile.openForWriting(true))
+    {
+        print(QStringLiteral("Error: could not write match file"));
+        return false;
+    }
+
+    for(const auto &folder : _folders)
+        watchFolder(QDir::fromNativeSeparators(folder), false);
+    if(_watcher.directories().isEmpty())
+    {
+        print(QStringLiteral("Error: no folder to watch"));
+        return false;
+    }
+    _settleTimer.start(_checkInterval);
+    print(QStringLiteral("Watching %1 folder(s), indexing %2 video(s)")
+          .arg(_watcher.directories().count()).arg(_known.count()));
+    return true;
+}
+
+void Watcher::watchFolder(const QString &folder, const bool &arrived)
+{
+    _watcher.addPath(folder);
+    QDirIterator subfolders(folder, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while(subfolders.hasNext())
+        _watcher.addPath(subfolders.next());
+
+    QDirIterator videos(folder, _extensions, QDir::Files, QDirIterator::Subdirectories);
+    while(videos.hasNext())
+    {
+        const QString filename = videos.next();
+        if(!arrived)
+            submit(filename, false);            //already there when started: only indexed
+        else if(!_known.contains(filename) && !_arriving.contains(filename))
+            _arriving.insert(filename, Arriving());
+    }
+}
+
+void Watcher::folderChanged(const QString &folder)
+{
+    if(!QFileInfo::exists(folder))
+    {
+        _watcher.removePath(folder);
+        return;
+    }
+    const QFileInfoList entries = QDir(folder).entryInfoList(_extensions, QDir::Files);
+    for(const auto &entry : entries)
+        if(!_known.contains(entry.filePath()) && !_arriving.contains(entry.filePath()))
+            _arriving.insert(entry.filePath(), Arriving());
+
+    const QFileInfoList subfolders = QDir(folder).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for(const auto &subfolder : subfolders)
+        if(!_watcher.directories().contains(subfolder.filePath()))
+            watchFolder(subfolder.filePath(), true);    //folder copied in may already have videos
+}
+
+void Watcher::checkArriving()
+{                                               //file is complete when it has not changed for a while
+    for(auto file=_arriving.begin(); file!=_arriving.end();)
+    {
+        const QFileInfo info(file.key());
+        if(!info.exists())
+        {
+            file = _arriving.erase(file);
+            continue;
+        }
+        Arriving &arriving = file.value();
+        if(!arriving.unchanged.isValid() || info.size() != arriving.size || info.lastModified() != arriving.modified)
+        {
+            arriving.size = info.size();
+            arriving.modified = info.lastModified();
+            arriving.unchanged.start();
+        }
+        else if(arriving.unchanged.elapsed() >= _settleTime && arriving.size > 0)
+        {
+            submit(file.key(), true);
+            file = _arriving.erase(file);
+            continue;
+        }
+        file++;
+    }
+}
+
+void Watcher::submit(const QString &filename, const bool &match)
+{
+    _known.insert(filename);
+    if(match)
+        _toMatch.insert(filename);
+    auto *videoTask = new Video(_prefs, filename);
+    videoTask->setAutoDelete(false);
+    connect(videoTask, SIGNAL(rejectVideo(Video *)), this, SLOT(removeVideo(Video *)));
+    connect(videoTask, SIGNAL(acceptVideo(Video *)), this, SLOT(addVideo(Video *)));
+    _threadPool.start(videoTask);
+}
+
+void Watcher::addVideo(Video *addMe)
+{
+    Indexed video;
+    video.filename = addMe->filename;
+    video.size = addMe->size;
+    video.duration = addMe->duration;
+    video.hash[0] = addMe->hash[0];
+    video.hash[1] = addMe->hash[1];
+    delete addMe;
+
+    if(_toMatch.remove(video.filename))
+    {
+        print(QStringLiteral("[%1] %2").arg(QTime::currentTime().toString(),
+                                            QDir::toNativeSeparators(video.filename)));
+        switch(_prefs._hashAlgorithm)
+        {
+            case Prefs::_DIFFERENCE: match<DifferenceHash>(video); break;
+            case Prefs::_AVERAGE:    match<AverageHash>(video); break;
+            case Prefs::_WAVELET:    match<WaveletHash>(video); break;
+            case Prefs::_DCT256:     match<WidePerceptualHash>(video); break;
+            default:                 match<PerceptualHash>(video);
+        }
+    }
+    _index << video;
+}
+
+void Watcher::removeVideo(Video *deleteMe)
+{
+    if(_toMatch.remove(deleteMe->filename))
+        print(QStringLiteral("[%1] ERROR reading %2").arg(QTime::currentTime().toString(),
+                                                          QDir::toNativeSeparators(deleteMe->filename)));
+    delete deleteMe;
+}
+
+template<class Hasher> void Watcher::match(const Indexed &arrived)
+{                                               //same rule as comparison window in pHash mode
+    const int hashes = _prefs._thumbnails == cutEnds? 2 : 1;
+    for(const auto &video : _index)
+    {
+        if(!Candidates::withinWindow(arrived.duration, video.duration, _prefs._durationWindowPercent,
+                                     _prefs._durationWindowSeconds, _prefs._thumbnails == cutEnds))
+            continue;
+
+        const bool sameDuration = qAbs(arrived.duration - video.duration) <= 1000;
+        const int modifier = sameDuration? _prefs._sameDurationModifier : -_prefs._differentDurationModifier;
+        int similarity = 0;
+        for(int hash=0; hash<hashes; hash++)
+            if(!arrived.hash[hash].isNull() || !video.hash[hash].isNull())
+                similarity = qMax(similarity, similarityOf64<Hasher>(arrived.hash[hash], video.hash[hash]));
+        if(qMin(similarity + modifier, 64) < _prefs._thresholdPhash)
+            continue;
+
+        print(QStringLiteral("    matches %1 (%2/64 same bits)")
+              .arg(QDir::toNativeSeparators(video.filename)).arg(similarity));
+        if(_writeMatches)
+        {
+            _matchFile.write(video.filename, video.size, video.duration,
+                             arrived.filename, arrived.size, arrived.duration, 64 - similarity, -1,
+                             _prefs._thumbnails);
+            _matchFile.flush();
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <QFileSystemWatcher>
+#include <QThreadPool>
+#include <QTimer>
+#include <QSet>
+#include "video.h"
+#include "matchfile.h"
+
+//headless mode that keeps running: videos in watched folders are fingerprinted once into an index held in memory,
+//then every video arriving later is matched against the index as soon as it has been completely written
+
+class Watcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    Watcher(const Prefs &prefsParam, const QStringList &foldersParam, const QString &matchFileParam);
+
+    //fingerprint existing videos and start watching, returns false if no folder could be watched
+    bool start();
+
+private:
+    struct Indexed                              //what matching needs of each video, not thumbnails or SSIM images
+    {
+        QString filename;
+        int64_t size;
+        int64_t duration;
+        Fingerprint hash[2];
+    };
+    struct Arriving
+    {
+        int64_t size = 0;
+        QDateTime modified;
+        QElapsedTimer unchanged;                //since size or modification time last changed
+    };
+
+    static constexpr int _settleTime = 3000;    //ms a new file must stay unchanged, else it is still being written
+    static constexpr int _checkInterval = 1000;
+
+    Prefs _prefs;
+    QStringList _folders;
+    QStringList _extensions;
+    QFileSystemWatcher _watcher;                //inotify on Linux
+    QTimer _settleTimer;
+    QThreadPool _threadPool;
+    MatchFile _matchFile;
+    bool _writeMatches;
+
+    QVector<Indexed> _index;
+    QSet<QString> _known;                       //in index, being processed or rejected
+    QHash<QString, Arriving> _arriving;         //waiting to be completely written
+    QSet<QString> _toMatch;                     //processing, matched when done (those found at start are not)
+
+    void loadExtensions();
+    void watchFolder(const QString &folder, const bool &arrived);
+    void submit(const QString &filename, const bool &match);
+    template<class Hasher> void match(const Indexed &arrived);
+    void print(const QString &line) const;
+
+private slots:
+    void folderChanged(const QString &folder);
+    void checkArriving();
+    void addVideo(Video *addMe);
+    void removeVideo(Video *deleteMe);
+};
+
+#endif // WATCHER_H
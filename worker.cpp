@@ -0,0 +1,108 @@
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QTextStream>
+#include <QThreadPool>
+#include "worker.h"
+#include "governor.h"
+
+Worker::Worker(const Prefs &prefsParam, const QString &listParam, const int &shardParam, const int &shardsParam,
+               const bool &shardByHash) :
+    _prefs(prefsParam), _list(listParam), _shard(shardParam), _shards(shardsParam), _shardByHash(shardByHash)
+{
+    _prefs._mainwPtr = nullptr;
+}
+
+QStringList Worker::filesOfShard() const
+{
+    QStringList files;
+    QFile list(_list);
+    if(!list.open(QIODevice::ReadOnly | QIODevice::Text))
+        return files;
+    QTextStream stream(&list);
+    stream.setCodec("UTF-8");
+    while(!stream.atEnd())
+    {
+        const QString filename = stream.readLine().trimmed();
+        if(!filename.isEmpty())
+            files << QDir::fromNativeSeparators(filename);
+    }
+
+    if(_shardByHash)                //same file always lands in same shard, whatever order the list is in
+    {
+        QStringList shard;
+        for(const auto &filename : files)
+        {
+            const QByteArray md5 = QCryptographicHash::hash(filename.toUtf8(), QCryptographicHash::Md5);
+            if(*reinterpret_cast<const quint32 *>(md5.constData()) % static_cast<quint32>(_shards) ==
+               static_cast<quint32>(_shard - 1))
+                shard << filename;
+        }
+        return shard;
+    }
+    const int first = files.count() * (_shard - 1) / _shards;
+    const int last = files.count() * _shard / _shards;
+    return files.mid(first, last - first);
+}
+
+int Worker::run()
+{
+    QTextStream out(stdout);
+    if(_shard < 1 || _shard > _shards)
+    {
+        out << QStringLiteral("Error: shard must be 1 to %1\n").arg(_shards);
+        return 1;
+    }
+    const QStringList files = filesOfShard();
+    if(files.isEmpty())
+    {
+        out << QStringLiteral("Error: no files in shard %1/%2 of %3\n").arg(_shard).arg(_shards).arg(_list);
+        return 1;
+    }
+    out << QStringLiteral("Shard %1/%2: %3 video(s) into %4\n").arg(_shard).arg(_shards).arg(files.count())
+                                                                .arg(QDir::toNativeSeparators(Db::cacheFile()));
+    out.flush();
+
+    _prefs._numberOfVideos = files.count();
+    Db::preload(_prefs._hashAlgorithm);
+    Governor governor;
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(governor.workers());
+    for(const auto &filename : files)
+    {
+        while(threadPool.activeThreadCount() >= threadPool.maxThreadCount())
+        {
+            QCoreApplication::processEvents();      //avoid blocking signals in event loop
+            if(governor.adapt())
+                threadPool.setMaxThreadCount(governor.workers());
+        }
+
+        auto *videoTask = new Video(_prefs, filename);
+        videoTask->setAutoDelete(false);
+        connect(videoTask, SIGNAL(rejectVideo(Video *)), this, SLOT(removeVideo(Video *)));
+        connect(videoTask, SIGNAL(acceptVideo(Video *)), this, SLOT(addVideo(Video *)));
+        threadPool.start(videoTask);
+    }
+    threadPool.waitForDone();
+    Db::releasePreload();
+    QCoreApplication::processEvents();              //process signals from last threads
+
+    out << QStringLiteral("%1 video(s) cached, %2 could not be read\n").arg(_processed - _rejected).arg(_rejected);
+    return 0;
+}
+
+void Worker::addVideo(Video *addMe)
+{
+    _processed++;
+    QTextStream(stdout) << QStringLiteral("[%1/%2] %3\n").arg(_processed).arg(_prefs._numberOfVideos)
+                                                        .arg(QDir::toNativeSeparators(addMe->filename));
+    delete addMe;                   //only cache is kept
+}
+
+void Worker::removeVideo(Video *deleteMe)
+{
+    _processed++;
+    _rejected++;
+    QTextStream(stdout) << QStringLiteral("[%1/%2] ERROR reading %3\n").arg(_processed).arg(_prefs._numberOfVideos)
+                                                                     .arg(QDir::toNativeSeparators(deleteMe->filename));
+    delete deleteMe;
+}
@@ -0,0 +1,36 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include "video.h"
+
+//headless ingest of one shard of a file list into its own cache file. shard caches are merged into one
+//afterwards and compared centrally, so first time processing of a large archive can be spread over many hosts
+
+class Worker : public QObject
+{
+    Q_OBJECT
+
+public:
+    Worker(const Prefs &prefsParam, const QString &listParam, const int &shardParam, const int &shardsParam,
+           const bool &shardByHash);
+
+    //process every video of shard, returns exit code
+    int run();
+
+private:
+    Prefs _prefs;
+    QString _list;
+    int _shard;                     //1 to _shards
+    int _shards;
+    bool _shardByHash;              //shard by hash of filename instead of continuous range of list
+    int _processed = 0;
+    int _rejected = 0;
+
+    QStringList filesOfShard() const;
+
+private slots:
+    void addVideo(Video *addMe);
+    void removeVideo(Video *deleteMe);
+};
+
+#endif // WORKER_H